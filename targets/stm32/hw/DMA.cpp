@@ -10,30 +10,182 @@
 
 #define MYDBG(...)  DBGCL("DMA", __VA_ARGS__)
 
-DMAChannel* DMA::ClaimChannel(uint32_t specs)
+#if DMA_STATS
+#define MYSTAT(name)            (link.stats.name++)
+#define MYSTAT_ADD(name, n)     (link.stats.name += (n))
+#else
+#define MYSTAT(name)
+#define MYSTAT_ADD(name, n)
+#endif
+
+uint32_t DMA::s_claimed;
+const void* DMA::s_owners[16];
+
+DMAChannel* DMA::ClaimChannel(uint32_t specs, const void* owner)
 {
+    if (!owner)
+    {
+        owner = __builtin_return_address(0);
+    }
+
     while (specs)
     {
         ChannelSpec spec = { .spec = uint8_t(specs) };
         auto dma = spec.dma ? DMA2 : DMA1;
         auto n = spec.ch - 1;   // zero-based index, the spec is one-based
+        auto bit = BIT(ClaimIndex(spec.dma, n));
         auto& ch = dma->CH[n];
-        if (!ch.CCR)
+
+        if (ch.CCR)
+        {
+            // configured directly (e.g. using a descriptor) without being claimed
+            specs >>= 8;
+            continue;
+        }
+
+        // atomically mark the channel as claimed
+        uint32_t claimed;
+        do
+        {
+            claimed = __LDREXW(&s_claimed);
+            if (claimed & bit)
+            {
+                break;
+            }
+        } while (__STREXW(claimed | bit, &s_claimed));
+
+        if (claimed & bit)
         {
-            auto off = n << 2;
+            __CLREX();
+            specs >>= 8;
+            continue;
+        }
+
+        s_owners[ClaimIndex(spec.dma, n)] = owner;
+
+        auto off = n << 2;
+        {
+            PLATFORM_CRITICAL_SECTION();
             dma->EnableClock();
             MODMASK(dma->CSELR, MASK(4) << off, spec.map << off);
-            ch.CCR = DMA_CCR_MEM2MEM;
-            MYDBG("DMA %d channel %d claimed for function %d", spec.dma + 1, spec.ch, spec.map);
-            return &ch;
         }
-        specs >>= 8;
+        ch.CCR = DMA_CCR_MEM2MEM;
+        MYDBG("DMA %d channel %d claimed for function %d by %08X", spec.dma + 1, spec.ch, spec.map, owner);
+        return &ch;
+    }
+
+    MYDBG("WARNING! Failed to claim a DMA channel for %08X", owner);
+    return NULL;
+}
+
+DMAChannel* DMA::ClaimMemoryChannel(const void* owner)
+{
+    if (!owner)
+    {
+        owner = __builtin_return_address(0);
+    }
+
+    // prefer DMA2 which typically has less peripheral requests mapped
+    for (unsigned i = 0; i < 14; i++)
+    {
+        ChannelSpec spec = { .spec = 0 };
+        spec.dma = i < 7;
+        spec.ch = 7 - i % 7;
+        // check the channel first, so that the busy ones don't produce claim failure warnings
+        if ((s_claimed & BIT(ClaimIndex(spec.dma, spec.ch - 1))) || (spec.dma ? DMA2 : DMA1)->CH[spec.ch - 1].CCR)
+        {
+            continue;
+        }
+        if (auto ch = ClaimChannel(spec.spec, owner))
+        {
+            return ch;
+        }
     }
 
-    MYDBG("WARNING! Failed to claim a DMA channel");
+    MYDBG("WARNING! No free DMA channel for %08X", owner);
     return NULL;
 }
 
+void DMA::ReleaseChannel(DMAChannel& ch)
+{
+    auto& dma = ch.DMA();
+    auto index = ClaimIndex(dma.Index(), ch.Index());
+    auto bit = BIT(index);
+
+    if (!(s_claimed & bit))
+    {
+        // channel used without claiming it, just make it available again
+        ch.CCR = 0;
+        return;
+    }
+
+    ch.IRQ().Disable();
+    ch.Unlink();
+    ch.CCR = 0;
+    ch.ClearInterrupt();
+    s_owners[index] = NULL;
+
+    uint32_t claimed;
+    do
+    {
+        claimed = __LDREXW(&s_claimed) & ~bit;
+    } while (__STREXW(claimed, &s_claimed));
+
+    MYDBG("DMA %d channel %d released", dma.Index() + 1, ch.Index() + 1);
+
+    PLATFORM_CRITICAL_SECTION();
+    if (!(s_claimed & (MASK(7) << ClaimIndex(dma.Index(), 0))))
+    {
+        // no more channels in use on this controller
+        RCC->DisableDMA(dma.Index());
+    }
+}
+
+const void* DMA::Owner(const DMAChannel& ch)
+{
+    return s_owners[ClaimIndex(ch.DMA().Index(), ch.Index())];
+}
+
+size_t DMA::GetClaims(ChannelClaim* claims, size_t max)
+{
+    size_t count = 0;
+    for (unsigned dma = 0; dma < 2; dma++)
+    {
+        uint32_t cselr = (dma ? DMA2 : DMA1)->CSELR;
+        for (unsigned n = 0; n < 7; n++)
+        {
+            auto index = ClaimIndex(dma, n);
+            if (!(s_claimed & BIT(index)))
+            {
+                continue;
+            }
+
+            if (count < max)
+            {
+                auto& claim = claims[count];
+                claim.spec.dma = dma;
+                claim.spec.ch = n + 1;
+                claim.spec.map = (cselr >> (n << 2)) & MASK(4);
+                claim.owner = s_owners[index];
+            }
+            count++;
+        }
+    }
+    return count;
+}
+
+void DMA::DumpClaims()
+{
+    ChannelClaim claims[14];
+    size_t count = GetClaims(claims, countof(claims));
+    MYDBG("%d channels claimed", count);
+    for (size_t i = 0; i < count; i++)
+    {
+        auto& c = claims[i];
+        MYDBG("DMA %d channel %d function %d owner %08X", c.spec.dma + 1, c.spec.ch, c.spec.map, c.owner);
+    }
+}
+
 class IRQ DMAChannel::IRQ() const
 {
     // need a lookup table as the numbers aren't completely contiguous
@@ -44,49 +196,164 @@ class IRQ DMAChannel::IRQ() const
         [DMA().Index() << 3 | Index()];
 }
 
-struct DMAChannelLink : DMA_Channel_TypeDef
+#ifndef DMA_LINK_QUEUE_DEPTH
+#define DMA_LINK_QUEUE_DEPTH    4       // number of buffers that can be queued after the running one
+#endif
+
+//! A transfer waiting to be automatically linked after the current one
+struct DMALinkEntry
+{
+    uint32_t CMAR;
+    uint32_t CNDTR;
+    uint32_t CPAR;
+};
+
+//! A memory unit split between buffers or misaligned, transferred through a staging word
+struct DMAStaging
 {
-    //! this field overlaps the reserved channel field to make the size the same as a full channel structure
-    //! we use it to store the full length of the currently running transfer
-    uint32_t CNDTR0;
+    enum State : uint8_t { Idle, Partial, Queued };
+
+    //! the unit being transferred
+    uint32_t word;
+    //! up to two parts of buffer memory covered by the unit
+    char* part[2];
+    uint8_t length[2];
+    //! number of bytes of the unit collected so far
+    uint8_t fill;
+    State state;
 };
 
-//! A structure holding the fields of the transfer to be automatically linked after the current one
-struct DMALinkInfo
+//! Buffer linking state of a single channel
+struct DMAChannelLink
 {
-    DMAChannelLink CH[7];
+    //! interrupt flags captured by the completion handler
+    uint32_t events;
+    //! counter incremented by the link handler on every interrupt, used to wake waiting tasks
+    //! and as a generation counter for taking consistent snapshots of the running transfer
+    volatile uint32_t progress;
+    //! configuration shared by all the queued transfers
+    uint32_t CCR, CPAR;
+    //! full length of the currently running transfer
+    uint16_t CNDTR0;
+    //! index of the first queued transfer
+    uint8_t head;
+    //! number of queued transfers
+    uint8_t count;
+    //! ring of transfers to be linked in order
+    DMALinkEntry queue[DMA_LINK_QUEUE_DEPTH];
+    //! unit that could not be linked directly
+    DMAStaging staging;
+    //! buffer memory position reported while the staged unit is running and after it completes
+    char* stageStart;
+    char* stageEnd;
+#if DMA_STATS
+    DMAChannelStats stats;
+#endif
+
+    DMALinkEntry& Last() { return queue[(head + count - 1) % DMA_LINK_QUEUE_DEPTH]; }
 };
 
 static inline DMAChannelLink& GetLink(DMAChannel* ch)
 {
-    static DMALinkInfo s_linkInfo[2];
-    return *(DMAChannelLink*)(uintptr_t(&s_linkInfo[ch->DMA().Index()]) + (uintptr_t(ch) & 0xFF));
+    static DMAChannelLink s_linkInfo[2][7];
+    return s_linkInfo[ch->DMA().Index()][ch->Index()];
 }
 
 struct DMALinkStatus
 {
-    char* end;
+    char* p;
     uint16_t cndtr;
-    uint16_t cndtr0;
 };
 
 //! Gets the status of the currently active transfer started via buffers linking
 static Packed<DMALinkStatus> GetStatus(DMAChannel* ch)
 {
-    bool wasEnabled = ch->IsEnabled();
-    ch->Disable();
+    // the link handler is the only code modifying the transfer registers of a running link
+    // and it cannot be interrupted by us, so the snapshot is consistent if it did not run
+    // while we were reading - the channel is never stopped, which would risk an overrun
+    auto& link = GetLink(ch);
+    uint8_t shift = ch->UnitShift();
+    char* p;
+    uint16_t cndtr;
+    uint32_t gen;
+
+    do
+    {
+        gen = link.progress;
+        auto cmar = ch->CMAR;
+        cndtr = ch->CNDTR;
+        if (cmar == uint32_t(&link.staging.word))
+        {
+            // the staged unit is not transferred to/from the buffer memory directly
+            p = cndtr ? link.stageStart : link.stageEnd;
+        }
+        else
+        {
+            p = (char*)cmar + ((((volatile DMAChannelLink&)link).CNDTR0 - cndtr) << shift);
+        }
+    } while (gen != link.progress);
+
+    return pack(DMALinkStatus { p, cndtr });
+}
+
+//! Adds a part of a unit that cannot be linked directly to the staging word, queueing it when complete
+/*! Returns the number of bytes consumed, only one unit can be staged at a time */
+static size_t Stage(DMAChannelLink& link, char* p, size_t len, unsigned shift, unsigned pshift)
+{
+    auto& s = link.staging;
+    if (s.state == DMAStaging::Queued || link.count == DMA_LINK_QUEUE_DEPTH)
+    {
+        return 0;
+    }
+
+    if (s.state == DMAStaging::Idle)
+    {
+        s.part[0] = p;
+        s.length[0] = s.length[1] = s.fill = 0;
+        s.state = DMAStaging::Partial;
+    }
+
+    // the unit can be split between the end of one buffer and the beginning of another
+    unsigned i = s.part[0] + s.length[0] != p;
+    if (i && !s.length[1])
+    {
+        s.part[1] = p;
+    }
+    ASSERT(s.part[i] + s.length[i] == p);
 
-    char* buf = (char*)ch->CMAR;
-    uint16_t cndtr = ch->CNDTR;
-    uint16_t cndtr0 = GetLink(ch).CNDTR0;
-    buf += cndtr0;
+    size_t n = std::min(len, size_t((1u << shift) - s.fill));
+    if (link.CCR & DMA_CCR_DIR)
+    {
+        // reading from memory, the data is collected right away
+        memcpy((char*)&s.word + s.fill, p, n);
+    }
+    s.length[i] += n;
+    s.fill += n;
 
-    if (wasEnabled)
+    if (s.fill == 1u << shift)
     {
-        ch->Enable();
+        link.count++;
+        link.Last() = { uint32_t(&s.word), 1, link.CPAR };
+        if (pshift < 32)
+        {
+            link.CPAR += 1 << pshift;
+        }
+        s.state = DMAStaging::Queued;
     }
+    return n;
+}
 
-    return pack(DMALinkStatus { buf, cndtr, cndtr0 });
+//! Completes the transfer of the staged unit
+static void Unstage(DMAChannelLink& link)
+{
+    auto& s = link.staging;
+    if (!(link.CCR & DMA_CCR_DIR))
+    {
+        // writing to memory, distribute the received unit to the buffers
+        memcpy(s.part[0], &s.word, s.length[0]);
+        memcpy(s.part[1], (char*)&s.word + s.length[0], s.length[1]);
+    }
+    s.state = DMAStaging::Idle;
 }
 
 size_t DMAChannel::TryLinkBuffer(Span buf)
@@ -97,27 +364,81 @@ size_t DMAChannel::TryLinkBuffer(Span buf)
     irq.Disable();
 
     auto& link = GetLink(this);
+    // CNDTR counts memory units, while the buffer length is in bytes
+    auto shift = UnitShift();
+    auto p = (char*)buf.Pointer();
+    auto end = p + buf.Length();
+    size_t linked = 0;
 
-    if (!link.CCR)
+    if (link.events & DMA_ISR_TEIF1)
     {
-        // configure the linked buffer with the same CCR and CPAR
-        link.CCR = CCR | DMA_CCR_TCIE | DMA_CCR_EN;
-        link.CPAR = CPAR;
-        link.CMAR = uint32_t(buf.Pointer());
-
-        // respect the maximum transfer size
-        buf = buf.Left(DMA_CNDTR_NDT);
-        link.CNDTR = buf.Length();
+        // nothing more is linked after a transfer error until the link is reset
+        irq.Enable();
+        return 0;
     }
-    else if (link.CMAR + link.CNDTR == uint32_t(buf.Pointer()))
+
+    if (!link.CCR)
     {
-        // extend the link buffer by as much as possible
-        buf = buf.Left(DMA_CNDTR_NDT - link.CNDTR);
-        link.CNDTR += buf.Length();
+        // configure the linked buffers with the same CCR and CPAR, only once until Unlink,
+        // as the running registers don't reflect the peripheral address advanced by linking
+        link.CCR = CCR | DMA_CCR_TCIE | DMA_CCR_TEIE | DMA_CCR_EN;
+        link.CPAR = CPAR;
     }
-    else
+
+    // when the peripheral address is incremented (memory-to-memory), it must advance with each linked segment
+    auto pshift = link.CCR & DMA_CCR_PINC ? (link.CCR & DMA_CCR_PSIZE) >> DMA_CCR_PSIZE_Pos : 32;
+
+    // long buffers are split into as many segments as the queue can hold
+    while (p != end)
     {
-        buf = {};
+        size_t units = (end - p) >> shift;
+        if (link.staging.state == DMAStaging::Partial || !units || (uint32_t(p) & MASK(shift)))
+        {
+            // a unit split between buffers or misaligned goes through the staging word,
+            // a partial unit must be completed first to keep the data in order
+            size_t n = Stage(link, p, end - p, shift, pshift);
+            if (!n)
+            {
+                MYSTAT(refused);
+                break;
+            }
+            p += n;
+            linked += n;
+            continue;
+        }
+
+        auto last = link.count ? &link.Last() : NULL;
+        uint32_t cmar = uint32_t(p);
+        size_t n;
+
+        if (last && last->CMAR + (last->CNDTR << shift) == cmar && last->CNDTR < DMA_CNDTR_NDT)
+        {
+            // extend the last queued buffer by as much as possible
+            n = std::min(units, size_t(DMA_CNDTR_NDT - last->CNDTR));
+            last->CNDTR += n;
+            MYSTAT(extended);
+        }
+        else if (link.count < DMA_LINK_QUEUE_DEPTH)
+        {
+            // append a new buffer to the queue, respecting the maximum transfer size
+            n = std::min(units, size_t(DMA_CNDTR_NDT));
+            link.count++;
+            link.Last() = { cmar, uint32_t(n), link.CPAR };
+            MYSTAT(linked);
+        }
+        else
+        {
+            // the queue is full
+            MYSTAT(refused);
+            break;
+        }
+
+        if (pshift < 32)
+        {
+            link.CPAR += n << pshift;
+        }
+        p += n << shift;
+        linked += n << shift;
     }
 
     irq.Enable();
@@ -127,58 +448,279 @@ size_t DMAChannel::TryLinkBuffer(Span buf)
         irq.Trigger();
     }
 
-    return buf.Length();
+    return linked;
 }
 
 void DMAChannel::LinkHandler()
 {
-    DMA().IFCR = DMA_IFCR_CTCIF1 << (Index() << 2);
+    uint32_t flags = DMA().ISR >> (Index() << 2);
+    DMA().IFCR = (DMA_IFCR_CTCIF1 | DMA_IFCR_CHTIF1 | DMA_IFCR_CTEIF1) << (Index() << 2);
     auto& link = GetLink(this);
-    ASSERT(CNDTR == 0);
+    link.progress++;
+
+    if ((flags & (DMA_ISR_HTIF1 | DMA_ISR_TCIF1 | DMA_ISR_TEIF1)) == DMA_ISR_HTIF1)
+    {
+        // just a progress notification
+        return;
+    }
+
+    ASSERT(CNDTR == 0 || (flags & DMA_ISR_TEIF1));
     Disable();
-    if (link.CCR)
+
+    if (CMAR == uint32_t(&link.staging.word) && link.staging.state == DMAStaging::Queued)
     {
-        link.CNDTR0 = CNDTR = link.CNDTR;
-        CPAR = link.CPAR;
-        CMAR = link.CMAR;
+        Unstage(link);
+    }
+
+    if (flags & DMA_ISR_TEIF1)
+    {
+        // stop at the first error, the queued transfers are dropped and the channel
+        // stays disabled, so nothing else is moved until the error is handled
+        link.events |= DMA_ISR_TEIF1;
+        link.count = 0;
+        link.staging.state = DMAStaging::Idle;
+        MYSTAT(errors);
+        return;
+    }
+    else if (flags & DMA_ISR_TCIF1)
+    {
+        MYSTAT_ADD(bytes, link.CNDTR0 << UnitShift());
+        if (!link.count)
+        {
+            MYSTAT(stalls);
+        }
+    }
+
+    if (link.count)
+    {
+        auto& next = link.queue[link.head];
+        link.CNDTR0 = CNDTR = next.CNDTR;
+        CPAR = next.CPAR;
+        CMAR = next.CMAR;
+        if (next.CMAR == uint32_t(&link.staging.word))
+        {
+            auto& st = link.staging;
+            link.stageStart = st.part[0];
+            link.stageEnd = st.length[1] ? st.part[1] + st.length[1] : st.part[0] + st.length[0];
+        }
         __DMB();    // make sure the other registers are written before re-enabling DMA
         CCR = link.CCR;
-        link.CCR = 0;
+        link.head = (link.head + 1) % DMA_LINK_QUEUE_DEPTH;
+        link.count--;
     }
 }
 
 void DMAChannel::Unlink()
 {
     Disable();
-    GetLink(this) = {};
+    auto& link = GetLink(this);
+    link.CCR = link.CPAR = 0;
+    link.CNDTR0 = link.head = link.count = 0;
+    link.staging.state = DMAStaging::Idle;
+    link.events = 0;
+}
+
+volatile uint32_t& DMAChannel::Events()
+{
+    return GetLink(this).events;
+}
+
+volatile uint32_t& DMAChannel::LinkProgress()
+{
+    return GetLink(this).progress;
 }
 
 const char* DMAChannel::LinkPointer()
 {
-    auto s = unpack<DMALinkStatus>(GetStatus(this));
-    return s.end - s.cndtr;
+    return unpack<DMALinkStatus>(GetStatus(this)).p;
+}
+
+#if DMA_STATS
+
+const DMAChannelStats& DMAChannel::Stats()
+{
+    return GetLink(this).stats;
 }
 
+void DMAChannel::ResetStats()
+{
+    GetLink(this).stats = {};
+}
+
+void DMA::DumpStats()
+{
+    ChannelClaim claims[14];
+    size_t count = GetClaims(claims, countof(claims));
+    for (size_t i = 0; i < std::min(count, countof(claims)); i++)
+    {
+        auto& spec = claims[i].spec;
+        auto& stats = (spec.dma ? DMA2 : DMA1)->Channel(spec.ch).Stats();
+        MYDBG("DMA %d channel %d: %u bytes, %u linked, %u extended, %u refused, %u stalls, %u errors",
+            spec.dma + 1, spec.ch, stats.bytes, stats.linked, stats.extended, stats.refused, stats.stalls, stats.errors);
+    }
+}
+
+#endif
+
 #if Ckernel
 
 async_once(DMAChannel::LinkPointerNot, const char* p, Timeout timeout)
 {
+    auto& link = GetLink(this);
+    uint32_t progress = link.progress;
     auto s = unpack<DMALinkStatus>(GetStatus(this));
-    uint32_t cndtr = s.end - p;
-    if (s.end - s.cndtr != p)
+    uint32_t cndtr = s.cndtr;
+    if (s.p != p)
     {
         async_once_return(true);
     }
-    if (cndtr)
-    {
-        return async_forward(WaitMaskNot, CNDTR, ~0u, cndtr, timeout);
-    }
-    else
+    if (!cndtr)
     {
         // we cannot reliably wait for inactive DMA to change - just yield and try again
         __pCallee.waitResult = {};
         return _ASYNC_RES(0, AsyncResult::SleepTicks);
     }
+    if (link.CCR & DMA_CCR_HTIE)
+    {
+        // the link handler will notify us about progress
+        return async_forward(WaitMaskNot, link.progress, ~0u, progress, timeout);
+    }
+    else
+    {
+        return async_forward(WaitMaskNot, CNDTR, ~0u, cndtr, timeout);
+    }
+}
+
+async_once(DMAChannel::WaitForComplete, Timeout timeout)
+{
+    if (!(CCR & DMA_CCR_TCIE))
+    {
+        // no interrupt to wait for, poll the status flag
+        return async_forward(WaitMaskNot, DMA().ISR, DMA_ISR_TCIF1 << (Index() << 2), 0, timeout);
+    }
+
+    // if the transfer has already completed, the interrupt is pending and the handler runs immediately
+    auto irq = IRQ();
+    irq.SetHandler(this, &DMAChannel::CompleteHandler);
+    irq.Enable();
+    return async_forward(WaitMaskNot, Events(), DMA_ISR_TCIF1 | DMA_ISR_TEIF1, 0, timeout);
+}
+
+async_once(DMAChannel::WaitForHalf, Timeout timeout)
+{
+    ASSERT((CCR & (DMA_CCR_TCIE | DMA_CCR_HTIE)) == (DMA_CCR_TCIE | DMA_CCR_HTIE));
+    auto irq = IRQ();
+    irq.SetHandler(this, &DMAChannel::CompleteHandler);
+    irq.Enable();
+    return async_forward(WaitMaskNot, Events(), DMA_ISR_HTIF1 | DMA_ISR_TCIF1 | DMA_ISR_TEIF1, 0, timeout);
+}
+
+void DMAChannel::CompleteHandler()
+{
+    uint32_t flags = (DMA().ISR >> (Index() << 2)) & MASK(4);
+    DMA().IFCR = InterruptMask();
+    if ((flags & DMA_ISR_TEIF1) || ((flags & DMA_ISR_TCIF1) && !(CCR & DMA_CCR_CIRC)))
+    {
+        Disable();
+    }
+    auto& link = GetLink(this);
+    link.events |= flags;
+    if (flags & DMA_ISR_TEIF1)
+    {
+        MYSTAT(errors);
+    }
+}
+
+async(DMAChannel::Transfer, Span buffer, Timeout timeout)
+async_def(
+    const char* p;
+    const char* end;
+    uint32_t progress;
+    Timeout timeout;
+)
+{
+    ASSERT(!IsEnabled());
+    // start over with the current CCR and CPAR
+    Unlink();
+    ClearInterrupt();
+    f.timeout = timeout.MakeAbsolute();
+    f.p = buffer.Pointer();
+    // a trailing partial unit is transferred through the staging word
+    f.end = f.p + buffer.Length();
+
+    while (f.p != f.end || GetLink(this).count || IsEnabled())
+    {
+        // capture progress before linking, the handler may start the transfer immediately
+        f.progress = GetLink(this).progress;
+        if (Events() & DMA_ISR_TEIF1)
+        {
+            // the link handler has already stopped the channel and dropped the queue
+            Unlink();
+            async_return(false);
+        }
+        if (f.p != f.end)
+        {
+            f.p += TryLinkBuffer(Span(f.p, f.end - f.p));
+        }
+
+        if (!await_mask_not_timeout(GetLink(this).progress, ~0u, f.progress, f.timeout))
+        {
+            Unlink();
+            async_return(false);
+        }
+    }
+
+    async_return(!(Events() & DMA_ISR_TEIF1));
+}
+async_end
+
+async(DMAChannel::Copy, void* destination, const void* source, size_t length)
+async_def()
+{
+    {
+        // use the largest unit the alignment allows
+        auto align = uintptr_t(destination) | uintptr_t(source) | length;
+        auto unit = align & 1 ? 0 : align & 2 ? 1 : 2;
+
+        CCR = DMADescriptor::M2M | DMADescriptor::IncrementMemory | DMADescriptor::IncrementPeripheral |
+            DMADescriptor::Flags(unit << DMA_CCR_PSIZE_Pos | unit << DMA_CCR_MSIZE_Pos);
+        CPAR = uint32_t(source);
+    }
+
+    bool result = await(Transfer, Span((const char*)destination, length));
+    if (!result)
+    {
+        MYDBG("Copy error at %08X -> %08X", source, destination);
+    }
+    async_return(result);
+}
+async_end
+
+async(DMAChannel::Fill, void* destination, uint8_t value, size_t length)
+async_def(
+    uint32_t value;
+)
+{
+    f.value = value * 0x01010101u;
+
+    {
+        // use the largest unit the alignment allows
+        auto align = uintptr_t(destination) | length;
+        auto unit = align & 1 ? 0 : align & 2 ? 1 : 2;
+
+        // the source is the fixed value, only the destination is incremented
+        CCR = DMADescriptor::M2M | DMADescriptor::IncrementMemory |
+            DMADescriptor::Flags(unit << DMA_CCR_PSIZE_Pos | unit << DMA_CCR_MSIZE_Pos);
+        CPAR = uint32_t(&f.value);
+    }
+
+    bool result = await(Transfer, Span((const char*)destination, length));
+    if (!result)
+    {
+        MYDBG("Fill error at %08X", destination);
+    }
+    async_return(result);
 }
+async_end
 
-#endif
\ No newline at end of file
+#endif
@@ -18,6 +18,10 @@
 #include <kernel/kernel.h>
 #endif
 
+#ifndef DMA_STATS
+#define DMA_STATS   0       // set to 1 to collect per-channel DMA statistics
+#endif
+
 struct DMADescriptor
 {
     uint32_t CCR, CNDTR, CPAR, CMAR;
@@ -36,7 +40,7 @@ struct DMADescriptor
         InterruptError = DMA_CCR_TEIE,
 
         P2M = 0,
-        P2P = 0,
+        P2P = 0,       //< peripheral-to-peripheral uses the P2M direction with CMAR pointing to the destination register
         M2P = DMA_CCR_DIR,
         M2M = DMA_CCR_MEM2MEM,
 
@@ -73,6 +77,14 @@ struct DMADescriptor
             (uint32_t)(flags & DMA_CCR_DIR ? source : destination),
         };
     }
+
+    //! Creates a descriptor forwarding every unit requested by the source peripheral directly to the destination register
+    /*! The channel must be mapped to the request of the source peripheral. No CPU intervention
+     *  is required, but the destination must be able to accept the data as fast as it arrives. */
+    static constexpr DMADescriptor Bridge(volatile const void* source, volatile void* destination, Flags flags = {})
+    {
+        return Transfer(source, destination, 1, Flags(flags | P2P | Circular));
+    }
 };
 
 DEFINE_FLAG_ENUM(DMADescriptor::Flags);
@@ -87,6 +99,21 @@ DEFINE_FLAG_ENUM(DMADescriptor::Flags);
 #define DMA2    CM_PERIPHERAL(DMA, DMA2_BASE)
 #endif
 
+#if DMA_STATS
+
+//! Statistics collected for a single DMA channel
+struct DMAChannelStats
+{
+    uint32_t bytes;         //< bytes moved by completed linked transfers
+    uint32_t linked;        //< buffers added to the link queue
+    uint32_t extended;      //< buffers merged into the last queued transfer
+    uint32_t refused;       //< buffers refused because the link queue was full
+    uint32_t stalls;        //< transfers completed with no further transfer queued
+    uint32_t errors;        //< transfer errors
+};
+
+#endif
+
 struct DMAChannel : DMA_Channel_TypeDef
 {
     uint32_t : 32;  // reserved word, not included in DMA_Channel_TypeDef
@@ -103,7 +130,7 @@ struct DMAChannel : DMA_Channel_TypeDef
     //! Returns true if the channel is enabled
     ALWAYS_INLINE bool IsEnabled() const { return CCR & DMA_CCR_EN; }
     //! Releases the channel (disables it and makes it available for other use)
-    ALWAYS_INLINE void Release() { CCR = 0; }
+    ALWAYS_INLINE void Release();
 
     //! Calculates the interrupt flag mask for this channel
     ALWAYS_INLINE constexpr uint32_t InterruptMask() const { return 0xF << (Index() << 2); }
@@ -112,6 +139,9 @@ struct DMAChannel : DMA_Channel_TypeDef
     //! Clears the interrupt flags and enables the channel
     ALWAYS_INLINE void ClearAndEnable() { ClearInterrupt(); Enable(); }
 
+    //! Gets the base-2 logarithm of the memory unit size configured for this channel
+    ALWAYS_INLINE unsigned UnitShift() const { return (CCR & DMA_CCR_MSIZE) >> DMA_CCR_MSIZE_Pos; }
+
     //! Gets the transfer count for this channel
     ALWAYS_INLINE uint32_t TransferCount() const { return CNDTR; }
     //! Sets the transfer count for this channel
@@ -123,15 +153,35 @@ struct DMAChannel : DMA_Channel_TypeDef
     class IRQ IRQ() const;
 
     //! Attempts to link a buffer, returning the number of bytes successfully linked
+    /*! Up to DMA_LINK_QUEUE_DEPTH buffers can be queued after the running transfer,
+     *  a buffer directly following the last queued one extends it instead.
+     *  Buffers longer than MaximumTransferSize units occupy multiple queue entries,
+     *  with the peripheral address advancing between them if it is incremented.
+     *  A unit split between buffers or not aligned to the unit size is transferred
+     *  through a staging word, which holds one unit at a time.
+     *  The channel configuration (CCR, CPAR) is captured by the first call after Unlink.
+     *  A transfer error stops the link and drops all queued buffers, nothing
+     *  is linked until the link is reset using Unlink */
     size_t TryLinkBuffer(Span buf);
-    //! Unlinks all buffers and stops the transfer to the current one
+    //! Unlinks all buffers, stops the transfer to the current one and clears a recorded transfer error
     void Unlink();
     //! Retrieves the memory location where next transfer will take place
     const char* LinkPointer();
+    //! Gets the counter incremented by the link handler on every interrupt
+    /*! LinkPointerNot sleeps until this counter changes when the linked transfers use InterruptHalf,
+     *  other interrupt handlers can increment it to wake the waiting task on additional events */
+    volatile uint32_t& LinkProgress();
 
     //! Gets the main descriptor
     DMADescriptor& Descriptor() { return *(DMADescriptor*)this; }
 
+#if DMA_STATS
+    //! Gets the statistics collected for the channel
+    const DMAChannelStats& Stats();
+    //! Resets the statistics collected for the channel
+    void ResetStats();
+#endif
+
 #if Ckernel
     ALWAYS_INLINE async_once(WaitForEnabled, bool state)
     async_once_def()
@@ -140,14 +190,38 @@ struct DMAChannel : DMA_Channel_TypeDef
     }
     async_end
 
-    async_once(WaitForComplete);
+    //! Waits until the transfer completes or fails
+    /*! If the transfer was started with InterruptComplete, the waiting task is woken
+     *  directly from the channel interrupt, otherwise the status flags are polled */
+    async_once(WaitForComplete, Timeout timeout = Timeout::Infinite);
+    //! Waits until the transfer reaches its half, completes or fails
+    /*! Requires the transfer to be started with InterruptHalf and InterruptComplete */
+    async_once(WaitForHalf, Timeout timeout = Timeout::Infinite);
     //! Waits until the transfer pointer moves away from the specified address
-    //! @warning Yields instead of waiting if the DMA is already stopped to avoid hanging
+    /*! If the linked transfers were configured with InterruptHalf, the waiting task is woken
+     *  from the channel interrupt at half and end of each transfer instead of polling CNDTR
+     *  @warning Yields instead of waiting if the DMA is already stopped to avoid hanging */
     async_once(LinkPointerNot, const char* p, Timeout timeout = Timeout::Infinite);
+
+    //! Transfers a buffer of arbitrary length using the configured CCR and CPAR, returns false on transfer error or timeout
+    /*! The buffer is split into segments of at most MaximumTransferSize units chained via the link queue,
+     *  so each segment is started directly from the interrupt handler when the previous one completes */
+    async(Transfer, Span buffer, Timeout timeout = Timeout::Infinite);
+
+    //! Copies memory using a memory-to-memory transfer, returns false on transfer error
+    /*! The largest unit allowed by the alignment of the arguments is used,
+     *  transfers longer than MaximumTransferSize units are chained automatically */
+    async(Copy, void* destination, const void* source, size_t length);
+    //! Fills memory with the specified value using a memory-to-memory transfer, returns false on transfer error
+    async(Fill, void* destination, uint8_t value, size_t length);
 #endif
 
 private:
+    //! Gets the interrupt flags recorded by the interrupt handler since the last ClearInterrupt
+    volatile uint32_t& Events();
+
     void LinkHandler();
+    void CompleteHandler();
 };
 
 struct DMA : DMA_TypeDef
@@ -175,14 +249,7 @@ struct DMA : DMA_TypeDef
     ALWAYS_INLINE bool TransferComplete(unsigned channel) { channel--; ASSERT(channel < 7); return ISR & 2 << (channel << 2); }
 
 #if Ckernel
-    ALWAYS_INLINE async_once(WaitForComplete, unsigned channel)
-    async_once_def()
-    {
-        channel--;
-        ASSERT(channel < 7);
-        await_mask_not(ISR, 2 << (channel < 2), 0);
-    }
-    async_end
+    ALWAYS_INLINE async_once(WaitForComplete, unsigned channel, Timeout timeout = Timeout::Infinite) { return async_forward(Channel(channel).WaitForComplete, timeout); }
 #endif
 
     struct ChannelSpec
@@ -199,17 +266,135 @@ struct DMA : DMA_TypeDef
         };
     };
 
-    static DMAChannel* ClaimChannel(const ChannelSpec& spec) { return ClaimChannel(spec.spec); }
-    static DMAChannel* ClaimChannel(const ChannelSpec& spec, const ChannelSpec& altSpec) { return ClaimChannel(spec.spec | altSpec.spec << 8); }
+    //! Information about a claimed channel
+    struct ChannelClaim
+    {
+        ChannelSpec spec;
+        const void* owner;
+    };
+
+    //! Claims the channel described by @p spec, @p owner is an arbitrary tag for diagnostics (defaults to the caller address)
+    /*! Channels in use without being claimed (non-zero CCR) are never handed out */
+    static DMAChannel* ClaimChannel(const ChannelSpec& spec, const void* owner = NULL) { return ClaimChannel(spec.spec, owner); }
+    //! Claims the channel described by @p spec, or @p altSpec if the first one is not available
+    static DMAChannel* ClaimChannel(const ChannelSpec& spec, const ChannelSpec& altSpec, const void* owner = NULL) { return ClaimChannel(spec.spec | altSpec.spec << 8, owner); }
+    //! Encodes a channel spec in a constant expression, matching the layout of ChannelSpec
+    static constexpr uint8_t Spec(unsigned dma, unsigned ch, unsigned map) { return dma | ch << 1 | map << 4; }
+    //! Encodes a peripheral DMA request that can be served using @p spec or the optional alternate @p altSpec
+    static constexpr uint16_t Request(uint8_t spec, uint8_t altSpec = 0) { return spec | altSpec << 8; }
+    //! Claims a channel for a request encoded using @ref Request, trying the alternate spec if the first one is not available
+    static DMAChannel* ClaimRequest(uint16_t request, const void* owner = NULL) { return ClaimChannel(uint32_t(request), owner); }
+    //! Claims any free channel, usable for memory-to-memory transfers
+    static DMAChannel* ClaimMemoryChannel(const void* owner = NULL);
+    //! Releases a previously claimed channel, gating the DMA clock when no channels remain claimed
+    /*! A channel that was configured directly without claiming it is just disabled */
+    static void ReleaseChannel(DMAChannel& ch);
+
+    //! Gets a bitmask of claimed channels, bits 0-6 correspond to DMA1 channels, bits 8-14 to DMA2 channels
+    static uint32_t ClaimedChannels() { return s_claimed; }
+    //! Gets the owner tag of a claimed channel
+    static const void* Owner(const DMAChannel& ch);
+    //! Fills the @p claims array with information about the currently claimed channels, returns the total number of claimed channels
+    static size_t GetClaims(ChannelClaim* claims, size_t max);
+    //! Dumps current channel assignments to the debug output
+    static void DumpClaims();
+#if DMA_STATS
+    //! Dumps statistics of all claimed channels to the debug output
+    static void DumpStats();
+#endif
 
 private:
-    static DMAChannel* ClaimChannel(uint32_t specs);
+    static DMAChannel* ClaimChannel(uint32_t specs, const void* owner);
+
+    static uint32_t s_claimed;
+    static const void* s_owners[16];
+
+    //! Gets the bit corresponding to the specified channel in the claimed channels bitmask
+    static constexpr unsigned ClaimIndex(unsigned dma, unsigned ch) { return dma << 3 | ch; }
 };
 
-ALWAYS_INLINE void DMAChannel::ClearInterrupt() { DMA().IFCR = InterruptMask(); }
+//! Compile-time assignment of DMA channels to a set of peripheral requests
+/*!
+ * Each request is encoded using @ref DMA::Request, peripherals provide them via their
+ * DmaRequest/DmaRxRequest/DmaTxRequest methods. The plan picks the primary or alternate
+ * channel for every request so that no two requests share a channel, compilation fails
+ * if no such assignment exists. Claiming a planned channel never falls back to an alternate.
+ *
+ * @code
+ * using Dmas = DMAPlan<USART1_t::DmaRxRequest(), USART1_t::DmaTxRequest(), _SDMMC<1>::DmaRequest()>;
+ * auto rx = Dmas::Claim<USART1_t::DmaRxRequest()>();
+ * @endcode
+ */
+template<uint16_t... requests> class DMAPlan
+{
+    static constexpr size_t count = sizeof...(requests);
+    static_assert(count > 0 && count <= 14, "Invalid number of DMA requests");
 
-#if Ckernel
+    static constexpr uint16_t s_requests[count] = { requests... };
+
+    struct Assignment
+    {
+        uint8_t specs[count];
+        bool valid;
+    };
+
+    //! Tries all combinations of primary and alternate channels, there are only a few requests with alternates so this stays cheap
+    static constexpr Assignment Solve()
+    {
+        for (uint32_t choice = 0; choice < (1u << count); choice++)
+        {
+            Assignment res = {};
+            uint32_t used = 0;
+            res.valid = true;
+            for (size_t i = 0; i < count && res.valid; i++)
+            {
+                uint8_t spec = s_requests[i] >> ((choice >> i & 1) << 3);
+                // the channel is identified by the dma and ch bits of the spec
+                uint32_t bit = 1u << (spec & MASK(4));
+                if (!spec || (used & bit))
+                {
+                    res.valid = false;
+                }
+                used |= bit;
+                res.specs[i] = spec;
+            }
+            if (res.valid)
+            {
+                return res;
+            }
+        }
+        return {};
+    }
 
-ALWAYS_INLINE async_once(DMAChannel::WaitForComplete) { return async_forward(DMA().WaitForComplete, Index() + 1); }
+    static constexpr Assignment s_plan = Solve();
+    static_assert(s_plan.valid, "Conflicting DMA requests, no channel assignment is possible");
+
+    static constexpr uint8_t SpecFor(uint16_t request)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if (s_requests[i] == request)
+            {
+                return s_plan.specs[i];
+            }
+        }
+        return 0;
+    }
+
+public:
+    //! Gets the spec of the channel assigned to @p request
+    template<uint16_t request> static constexpr uint8_t Spec()
+    {
+        static_assert(SpecFor(request), "The request is not part of the DMA plan");
+        return SpecFor(request);
+    }
+
+    //! Claims the channel assigned to @p request
+    template<uint16_t request> static DMAChannel* Claim(const void* owner = NULL)
+    {
+        return DMA::ClaimRequest(Spec<request>(), owner);
+    }
+};
 
-#endif
\ No newline at end of file
+ALWAYS_INLINE void DMAChannel::Release() { DMA::ReleaseChannel(*this); }
+ALWAYS_INLINE void DMAChannel::ClearInterrupt() { DMA().IFCR = InterruptMask(); Events() = 0; }
\ No newline at end of file
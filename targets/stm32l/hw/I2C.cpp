@@ -22,6 +22,7 @@ const GPIOPinTables_t I2C::afSda = { _I2C<1>::afSda, _I2C<2>::afSda, _I2C<3>::af
 static constexpr uint32_t I2C_ISR_ERR = I2C_ISR_ARLO | I2C_ISR_NACKF;
 static constexpr uint32_t I2C_ICR_ERR = I2C_ICR_BERRCF | I2C_ICR_ARLOCF | I2C_ICR_NACKCF | I2C_ICR_STOPCF;
 static constexpr uint32_t I2C_ISR_OK = I2C_ISR_TC | I2C_ISR_TCR | I2C_ISR_STOPF;
+static constexpr uint32_t I2C_CR1_TRANSACTION_IE = I2C_CR1_TCIE | I2C_CR1_STOPIE | I2C_CR1_NACKIE | I2C_CR1_ERRIE;
 
 async(I2C::Reset)
 async_def_sync(unsigned i)
@@ -123,7 +124,9 @@ async_def(
     volatile uint32_t* reg;
     char* data;
     char* end;
+    char* chunk;
     IRQ ev;
+    DMAChannel* dma;
 
     void ReadHandler()
     {
@@ -141,9 +144,25 @@ async_def(
 
     await(Acquire);
 
-    f.ev = i2c.EventIRQ();
-    f.ev.SetHandler(&f, &__FRAME::ReadHandler);
-    f.ev.Enable();
+    if ((f.dma = data.Length() ? i2c.DmaRx() : NULL))
+    {
+        // the whole buffer is received by DMA, regardless of the NBYTES chunks
+        ASSERT(data.Length() <= DMADescriptor::MaximumTransferSize);
+        // the transfer registers are read-only while the channel is enabled
+        f.dma->Disable();
+        f.dma->CPAR = uint32_t(f.reg);
+        f.dma->CMAR = uint32_t(f.data);
+        f.dma->CNDTR = data.Length();
+        f.dma->CCR = DMADescriptor::P2M | DMADescriptor::IncrementMemory | DMADescriptor::UnitByte | DMADescriptor::PrioHigh;
+        f.dma->ClearAndEnable();
+        i2c.CR1 |= I2C_CR1_RXDMAEN;
+    }
+    else
+    {
+        f.ev = i2c.EventIRQ();
+        f.ev.SetHandler(&f, &__FRAME::ReadHandler);
+        f.ev.Enable();
+    }
 
     // clear any previous errors
     i2c.ICR = I2C_ICR_ERR;
@@ -167,20 +186,33 @@ async_def(
             nbytes << I2C_CR2_NBYTES_Pos;
 
         reloaded = reload;
+        f.chunk = f.data + nbytes;
 
-        // enable interrupt to pull data
-        i2c.CR1 |= I2C_CR1_RXIE;
+        if (!f.dma)
+        {
+            // enable interrupt to pull data
+            i2c.CR1 |= I2C_CR1_RXIE;
+        }
 
         bool done = await_mask_not_ms(i2c.ISR, I2C_ISR_ERR | I2C_ISR_OK, 0, I2C_TIMEOUT);
 
-        // disable interrupt
-        i2c.CR1 &= ~I2C_CR1_RXIE;
+        if (f.dma)
+        {
+            // the last byte of the chunk may still be waiting for the DMA,
+            // but the clock is stretched until it is read, so nothing gets lost
+            f.data = done && !(i2c.ISR & I2C_ISR_ERR) ? f.chunk : f.end - f.dma->CNDTR;
+        }
+        else
+        {
+            // disable interrupt
+            i2c.CR1 &= ~I2C_CR1_RXIE;
+        }
 
         wx = f.data - data.begin();
 
         if (!done || (i2c.ISR & I2C_ISR_ERR))
         {
-            f.ev.ResetHandler();
+            StopTransfer(f.dma, f.ev);
 
             MYDBG("%s %X", done ? "ERROR" : "TIMEOUT", i2c.ISR);
             await(i2c.Reset);
@@ -190,7 +222,17 @@ async_def(
         }
     }
 
-    f.ev.ResetHandler();
+    if (f.dma && !await_mask_ms(f.dma->CNDTR, ~0u, 0, I2C_TIMEOUT))
+    {
+        // the DMA never picked up the last byte (transfer error)
+        StopTransfer(f.dma, f.ev);
+
+        MYDBG("DMA TIMEOUT %X", f.dma->DMA().ISR);
+        await(i2c.Reset);
+        Release();
+        async_return(false);
+    }
+    StopTransfer(f.dma, f.ev);
     if (next == Next::Stop)
     {
         // done, release the bus
@@ -205,7 +247,9 @@ async_def(
     volatile uint32_t* reg;
     const char* data;
     const char* end;
+    const char* chunk;
     IRQ ev;
+    DMAChannel* dma;
 
     void WriteHandler()
     {
@@ -222,9 +266,25 @@ async_def(
 
     await(Acquire);
 
-    f.ev = i2c.EventIRQ();
-    f.ev.SetHandler(&f, &__FRAME::WriteHandler);
-    f.ev.Enable();
+    if ((f.dma = data.Length() ? i2c.DmaTx() : NULL))
+    {
+        // the whole buffer is transmitted by DMA, regardless of the NBYTES chunks
+        ASSERT(data.Length() <= DMADescriptor::MaximumTransferSize);
+        // the transfer registers are read-only while the channel is enabled
+        f.dma->Disable();
+        f.dma->CPAR = uint32_t(f.reg);
+        f.dma->CMAR = uint32_t(f.data);
+        f.dma->CNDTR = data.Length();
+        f.dma->CCR = DMADescriptor::M2P | DMADescriptor::IncrementMemory | DMADescriptor::UnitByte | DMADescriptor::PrioHigh;
+        f.dma->ClearAndEnable();
+        i2c.CR1 |= I2C_CR1_TXDMAEN;
+    }
+    else
+    {
+        f.ev = i2c.EventIRQ();
+        f.ev.SetHandler(&f, &__FRAME::WriteHandler);
+        f.ev.Enable();
+    }
 
     // clear any previous errors
     i2c.ICR = I2C_ICR_ERR;
@@ -248,20 +308,31 @@ async_def(
             nbytes << I2C_CR2_NBYTES_Pos;
 
         reloaded = reload;
+        f.chunk = f.data + nbytes;
 
-        // enable interrupt to push data
-        i2c.CR1 |= I2C_CR1_TXIE;
+        if (!f.dma)
+        {
+            // enable interrupt to push data
+            i2c.CR1 |= I2C_CR1_TXIE;
+        }
 
         bool done = await_mask_not_ms(i2c.ISR, I2C_ISR_ERR | I2C_ISR_OK, 0, I2C_TIMEOUT);
 
-        // disable interrupt to push data
-        i2c.CR1 &= ~I2C_CR1_TXIE;
+        if (f.dma)
+        {
+            f.data = done && !(i2c.ISR & I2C_ISR_ERR) ? f.chunk : f.end - f.dma->CNDTR;
+        }
+        else
+        {
+            // disable interrupt to push data
+            i2c.CR1 &= ~I2C_CR1_TXIE;
+        }
 
         wx = f.data - data.begin();
 
         if (!done || (i2c.ISR & I2C_ISR_ERR))
         {
-            f.ev.ResetHandler();
+            StopTransfer(f.dma, f.ev);
 
             MYDBG("%s %X", done ? "ERROR" : "TIMEOUT", i2c.ISR);
             await(i2c.Reset);
@@ -270,7 +341,7 @@ async_def(
         }
     }
 
-    f.ev.ResetHandler();
+    StopTransfer(f.dma, f.ev);
     if (next == Next::Stop)
     {
         // done, release the bus
@@ -280,6 +351,333 @@ async_def(
 }
 async_end
 
+async(I2C::Device::Transaction, const Segment* segments, size_t count)
+async_def(
+    I2C* bus;
+    uint32_t address;
+    const Segment* seg;
+    const Segment* segEnd;
+    char* p;
+    char* chunk;
+    char* end;
+    DMAChannel* rx;
+    DMAChannel* tx;
+    DMAChannel* dma;            //< channel used by the current segment, NULL if the data is moved by the handler
+    IRQ ev, er;
+    volatile uint32_t result;   //< 0 while running, I2C_ISR_STOPF on success, error flags on failure
+    volatile uint32_t progress; //< incremented on every finished chunk, re-arms the timeout
+    bool dmaWait;               //< the segment is finished once the DMA picks up the last received byte
+    bool dmaRestart;            //< the next chunk is started with a repeated start after dmaWait
+
+    void StartSegment()
+    {
+        p = seg->data;
+        end = p + seg->length;
+        // the channels are disabled also when the direction changes, so the next transfer
+        // (which expects them disabled) can program them
+        DisableDma();
+        if ((dma = seg->read ? rx : tx))
+        {
+            dma->CPAR = uint32_t(seg->read ? &bus->RXDR : &bus->TXDR);
+            dma->CMAR = uint32_t(p);
+            dma->CNDTR = seg->length;
+            dma->CCR = (seg->read ? DMADescriptor::P2M : DMADescriptor::M2P) | DMADescriptor::IncrementMemory | DMADescriptor::UnitByte | DMADescriptor::PrioHigh |
+                DMADescriptor::InterruptComplete | DMADescriptor::InterruptError;
+            dma->ClearAndEnable();
+        }
+        MODMASK(bus->CR1, I2C_CR1_RXDMAEN | I2C_CR1_TXDMAEN | I2C_CR1_RXIE | I2C_CR1_TXIE,
+            seg->read ? (dma ? I2C_CR1_RXDMAEN : I2C_CR1_RXIE) : (dma ? I2C_CR1_TXDMAEN : I2C_CR1_TXIE));
+    }
+
+    void DisableDma()
+    {
+        if (rx)
+        {
+            rx->Disable();
+        }
+        if (tx)
+        {
+            tx->Disable();
+        }
+    }
+
+    void StartChunk(bool start)
+    {
+        unsigned nbytes = std::min(end - p, ptrdiff_t(255));
+        // keep the direction with RELOAD, or let TC occur to generate a repeated start
+        bool more = p + nbytes < end || (seg + 1 < segEnd && seg[1].read == seg->read);
+        bool stop = !more && seg + 1 == segEnd;
+        chunk = p + nbytes;
+
+        bus->CR2 = address | seg->read * I2C_CR2_RD_WRN |
+            start * I2C_CR2_START |
+            more * I2C_CR2_RELOAD |
+            stop * I2C_CR2_AUTOEND |
+            nbytes << I2C_CR2_NBYTES_Pos;
+    }
+
+    void Next(bool restart)
+    {
+        progress++;
+        p = chunk;
+        if (p != end)
+        {
+            StartChunk(restart);
+            return;
+        }
+
+        if (dma && seg->read)
+        {
+            // the DMA may not have picked up the last byte yet (the clock is stretched until then),
+            // in that case the DMA interrupt continues with the next segment
+            PLATFORM_CRITICAL_SECTION();
+            if (dma->CNDTR)
+            {
+                // TC/TCR remain set until the next chunk is started
+                bus->CR1 &= ~I2C_CR1_TCIE;
+                dmaWait = true;
+                dmaRestart = restart;
+                return;
+            }
+        }
+
+        NextSegment(restart);
+    }
+
+    void NextSegment(bool restart)
+    {
+        if (++seg == segEnd)
+        {
+            return;
+        }
+        StartSegment();
+        StartChunk(restart);
+    }
+
+    void Finish(uint32_t res)
+    {
+        bus->CR1 &= ~(I2C_CR1_TRANSACTION_IE | I2C_CR1_RXIE | I2C_CR1_TXIE | I2C_CR1_RXDMAEN | I2C_CR1_TXDMAEN);
+        DisableDma();
+        dmaWait = false;
+        result = res;
+        progress++;
+    }
+
+    static uint32_t TakeDmaFlags(DMAChannel* ch)
+    {
+        if (!ch)
+        {
+            return 0;
+        }
+        uint32_t flags = ch->DMA().ISR >> (ch->Index() << 2);
+        ch->ClearInterrupt();
+        return flags;
+    }
+
+    void DmaHandler()
+    {
+        uint32_t rxFlags = TakeDmaFlags(rx);
+        uint32_t txFlags = TakeDmaFlags(tx);
+
+        if (result)
+        {
+            return;
+        }
+
+        if ((rxFlags | txFlags) & DMA_ISR_TEIF1)
+        {
+            // the data cannot be moved, report as a bus error
+            Finish(I2C_ISR_BERR);
+            return;
+        }
+
+        if (dmaWait && (rxFlags & DMA_ISR_TCIF1))
+        {
+            progress++;
+            dmaWait = false;
+            bus->CR1 |= I2C_CR1_TCIE;
+            NextSegment(dmaRestart);
+        }
+    }
+
+    void Handler()
+    {
+        auto isr = bus->ISR;
+        if (isr & (I2C_ISR_NACKF | I2C_ISR_ARLO | I2C_ISR_BERR))
+        {
+            Finish(isr & (I2C_ISR_NACKF | I2C_ISR_ARLO | I2C_ISR_BERR));
+            return;
+        }
+
+        if (!dma)
+        {
+            if (isr & I2C_ISR_RXNE)
+            {
+                auto b = bus->RXDR;
+                if (p < chunk)
+                {
+                    *p++ = b;
+                }
+            }
+            if (isr & I2C_ISR_TXIS)
+            {
+                bus->TXDR = p < chunk ? *p++ : 0;
+                __DSB();    // make sure the write is completed, otherwise the interrupt may get re-triggered
+            }
+        }
+
+        if (isr & I2C_ISR_TCR)
+        {
+            Next(false);
+        }
+        else if (isr & I2C_ISR_TC)
+        {
+            Next(true);
+        }
+
+        if (isr & I2C_ISR_STOPF)
+        {
+            bus->ICR = I2C_ICR_STOPCF;
+            Finish(I2C_ISR_STOPF);
+        }
+    }
+)
+{
+    ASSERT(count && !reloaded);
+    for (size_t i = 0; i < count; i++)
+    {
+        ASSERT(segments[i].length && segments[i].length <= DMADescriptor::MaximumTransferSize);
+    }
+
+    await(Acquire);
+
+    f.bus = &i2c;
+    f.address = address << 1;
+    f.seg = segments;
+    f.segEnd = segments + count;
+    f.rx = i2c.DmaRx();
+    f.tx = i2c.DmaTx();
+    f.result = 0;
+    f.progress = 0;
+    f.dmaWait = false;
+
+    f.ev = i2c.EventIRQ();
+    f.er = i2c.ErrorIRQ();
+    f.ev.SetHandler(&f, &__FRAME::Handler);
+    f.er.SetHandler(&f, &__FRAME::Handler);
+    f.ev.Enable();
+    f.er.Enable();
+    for (auto dma: { f.rx, f.tx })
+    {
+        if (dma)
+        {
+            dma->IRQ().SetHandler(&f, &__FRAME::DmaHandler);
+            dma->IRQ().Enable();
+        }
+    }
+
+    // clear any previous errors
+    i2c.ICR = I2C_ICR_ERR;
+
+    f.StartSegment();
+    i2c.CR1 |= I2C_CR1_TRANSACTION_IE;
+    f.StartChunk(true);
+
+    // the timeout applies to each chunk (at most 255 bytes), not to the whole transaction
+    for (;;)
+    {
+        uint32_t progress = f.progress;
+        if (f.result)
+        {
+            break;
+        }
+        if (!await_mask_not_ms(f.progress, ~0u, progress, I2C_TIMEOUT))
+        {
+            f.Finish(0);
+            break;
+        }
+    }
+
+    f.ev.ResetHandler();
+    f.er.ResetHandler();
+    for (auto dma: { f.rx, f.tx })
+    {
+        if (dma)
+        {
+            dma->IRQ().ResetHandler();
+        }
+    }
+
+    if (f.result != I2C_ISR_STOPF)
+    {
+        MYDBG("transaction %s in segment %d, ISR: %X", f.result ? "ERROR" : "TIMEOUT", f.seg - segments, i2c.ISR);
+        await(i2c.Reset);
+        Release();
+        async_return(f.seg - segments);
+    }
+
+    Release();
+    async_return(count);
+}
+async_end
+
+void I2C::Device::StopTransfer(DMAChannel* dma, IRQ& ev)
+{
+    if (dma)
+    {
+        i2c.CR1 &= ~(I2C_CR1_RXDMAEN | I2C_CR1_TXDMAEN);
+        dma->Disable();
+    }
+    else
+    {
+        ev.ResetHandler();
+    }
+}
+
+#pragma region DMA
+
+static constexpr uint16_t s_dmaRequests[3][2] = {
+    { _I2C<1>::DmaRxRequest(), _I2C<1>::DmaTxRequest() },
+    { _I2C<2>::DmaRxRequest(), _I2C<2>::DmaTxRequest() },
+    { _I2C<3>::DmaRxRequest(), _I2C<3>::DmaTxRequest() },
+};
+
+static DMAChannel* s_dma[3][2];
+
+bool I2C::UseDma()
+{
+    if (s_dma[Index()][0])
+    {
+        return true;
+    }
+
+    auto rx = DMA::ClaimRequest(s_dmaRequests[Index()][0], this);
+    auto tx = rx ? DMA::ClaimRequest(s_dmaRequests[Index()][1], this) : NULL;
+    if (!tx)
+    {
+        if (rx)
+        {
+            rx->Release();
+        }
+        MYDBG("DMA not available, using interrupts");
+        return false;
+    }
+
+    UseDma(rx, tx);
+    return true;
+}
+
+void I2C::UseDma(DMAChannel* rx, DMAChannel* tx)
+{
+    s_dma[Index()][0] = rx;
+    s_dma[Index()][1] = tx;
+}
+
+DMAChannel* I2C::DmaRx() const { return s_dma[Index()][0]; }
+DMAChannel* I2C::DmaTx() const { return s_dma[Index()][1]; }
+
+#pragma endregion
+
 #pragma region Pin Definitions
 
 template<> const GPIOPinTable_t _I2C<1>::afScl = GPIO_PINS(pB(6, 4), pB(8, 4), pG(14, 4));
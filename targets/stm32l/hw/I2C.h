@@ -13,6 +13,7 @@
 #include <base/Span.h>
 #include <hw/IRQ.h>
 #include <hw/GPIO.h>
+#include <hw/DMA.h>
 #include <hw/RCC.h>
 
 #undef I2C1
@@ -61,6 +62,16 @@ struct I2C : I2C_TypeDef
     //! Resets the bus
     async(Reset);
 
+    //! Claims the RX/TX DMA channels of the bus, subsequent transfers use DMA instead of per-byte interrupts
+    /*! Returns false if the channels are not available, the transfers then keep using interrupts */
+    bool UseDma();
+    //! Uses the specified DMA channels for subsequent transfers, e.g. channels assigned using DMAPlan, or NULL to use interrupts
+    void UseDma(DMAChannel* rx, DMAChannel* tx);
+    //! Gets the DMA channel used for receiving, NULL if not using DMA
+    DMAChannel* DmaRx() const;
+    //! Gets the DMA channel used for transmitting, NULL if not using DMA
+    DMAChannel* DmaTx() const;
+
     //! Next action after this operation
     enum struct Next
     {
@@ -72,6 +83,17 @@ struct I2C : I2C_TypeDef
         Restart
     };
 
+    //! Segment of a transaction, see Device::Transaction
+    struct Segment
+    {
+        char* data;
+        size_t length;      //< at most DMADescriptor::MaximumTransferSize
+        bool read;
+
+        static Segment Write(Span data) { return { (char*)data.Pointer(), data.Length(), false }; }
+        static Segment Read(Buffer data) { return { data.Pointer(), data.Length(), true }; }
+    };
+
     //! Device control structure
     class Device
     {
@@ -95,6 +117,12 @@ struct I2C : I2C_TypeDef
 
         async(Read, Buffer data, Next next = Next::Stop);
         async(Write, Span data, Next next = Next::Stop);
+        //! Executes a list of segments as a single transaction, returns @p count on success or the index of the failed segment
+        /*! Consecutive segments in the same direction are joined, a repeated start is generated whenever
+         *  the direction changes and the transaction is finished with a stop condition. The segments
+         *  are sequenced by the interrupt handler, moving the data using DMA if enabled using UseDma,
+         *  so the calling task is woken up only once at the end */
+        async(Transaction, const Segment* segments, size_t count);
 
     private:
         unsigned Index() const { return i2c.Index(); }
@@ -103,6 +131,8 @@ struct I2C : I2C_TypeDef
         async(Acquire);
         //! Releases the bus
         void Release();
+        //! Stops moving data using the DMA or interrupt handler
+        void StopTransfer(DMAChannel* dma, IRQ& ev);
     };
 
     constexpr Device Master(uint8_t address) { return Device(*this, address); }
@@ -123,5 +153,17 @@ template<unsigned n> struct _I2C : I2C
         { pin.ConfigureAlternate(afScl, mode | GPIOPin::OpenDrain | GPIOPin::FlagSet); }
     void ConfigureSda(GPIOPin pin, GPIOPin::Mode mode = GPIOPin::SpeedMedium)
         { pin.ConfigureAlternate(afSda, mode | GPIOPin::OpenDrain | GPIOPin::FlagSet); }
+
+    //! Gets the DMA request for receiving, usable with DMAPlan
+    static constexpr uint16_t DmaRxRequest();
+    //! Gets the DMA request for transmitting, usable with DMAPlan
+    static constexpr uint16_t DmaTxRequest();
 };
 
+template<> constexpr uint16_t _I2C<1>::DmaRxRequest() { return DMA::Request(DMA::Spec(0, 7, 3), DMA::Spec(1, 6, 5)); }
+template<> constexpr uint16_t _I2C<1>::DmaTxRequest() { return DMA::Request(DMA::Spec(0, 6, 3), DMA::Spec(1, 7, 5)); }
+template<> constexpr uint16_t _I2C<2>::DmaRxRequest() { return DMA::Request(DMA::Spec(0, 5, 3)); }
+template<> constexpr uint16_t _I2C<2>::DmaTxRequest() { return DMA::Request(DMA::Spec(0, 4, 3)); }
+template<> constexpr uint16_t _I2C<3>::DmaRxRequest() { return DMA::Request(DMA::Spec(0, 3, 3)); }
+template<> constexpr uint16_t _I2C<3>::DmaTxRequest() { return DMA::Request(DMA::Spec(0, 2, 3)); }
+
@@ -44,11 +44,31 @@ struct _RCC : RCC_TypeDef
         __DSB();
     }
 
+    void DisableDMA(unsigned index)
+    {
+        ASSERT(index < 2);
+        AHB1ENR &= ~(RCC_AHB1ENR_DMA1EN << index);
+    }
+
+    //! Gets the system clock frequency, derived from HCLK (SystemCoreClock) and the AHB prescaler
+    uint32_t SYSCLK() const
+    {
+        unsigned hpre = (CFGR & RCC_CFGR_HPRE) >> RCC_CFGR_HPRE_Pos;
+        // /2 to /16 and /64 to /512, there is no /32
+        return SystemCoreClock << (hpre & 8 ? (hpre & 7) + 1 + ((hpre & 7) >= 4) : 0);
+    }
+    //! Gets the APB1 peripheral clock frequency
+    uint32_t PCLK1() const { return SystemCoreClock >> APBShift((CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos); }
+    //! Gets the APB2 peripheral clock frequency
+    uint32_t PCLK2() const { return SystemCoreClock >> APBShift((CFGR & RCC_CFGR_PPRE2) >> RCC_CFGR_PPRE2_Pos); }
+
     static enum ResetCause ResetCause() { return s_resetCause; }
 
     static void __CaptureResetCause();
 private:
     static enum ResetCause s_resetCause;
+
+    static constexpr unsigned APBShift(unsigned ppre) { return ppre & 4 ? (ppre & 3) + 1 : 0; }
 };
 
 DEFINE_FLAG_ENUM(enum _RCC::ResetCause);
@@ -471,11 +471,14 @@ struct _SDMMC : SDMMC
     void ConfigureD7(GPIOPin pin, GPIOPin::Mode mode = GPIOPin::SpeedVeryHigh)
         { pin.ConfigureAlternate(afD7, mode); }
 
-    DMAChannel* Dma() const;
+    //! Gets the DMA request, usable with DMAPlan
+    static constexpr uint16_t DmaRequest();
+
+    DMAChannel* Dma() const { return DMA::ClaimRequest(DmaRequest()); }
 };
 
 #undef SDMMC1
 #define SDMMC1  CM_PERIPHERAL(_SDMMC<1>, SDMMC1_BASE)
 
 template<> inline void _SDMMC<1>::EnableClock() const { RCC->APB2ENR |= RCC_APB2ENR_SDMMC1EN; __DSB(); }
-template<> inline DMAChannel* _SDMMC<1>::Dma() const { return DMA::ClaimChannel({ 1, 4, 7 }, { 1, 5, 7 }); }
+template<> constexpr uint16_t _SDMMC<1>::DmaRequest() { return DMA::Request(DMA::Spec(1, 4, 7), DMA::Spec(1, 5, 7)); }
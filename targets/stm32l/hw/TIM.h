@@ -74,7 +74,9 @@ struct _TIMChannel : _TIMChReg<n>
     ALWAYS_INLINE constexpr _TIM<ntim>& Timer() const { return *(_TIM<ntim>*)this; }
     //! Gets the zero-based index of the channel
     ALWAYS_INLINE constexpr unsigned Index() const { return n - 1; }
-    ALWAYS_INLINE DMAChannel* Dma() const { static_assert(false, "DMA not available for this channel"); return NULL; }
+    //! Gets the DMA request of the channel, usable with DMAPlan
+    static constexpr uint16_t DmaRequest() { static_assert(n == 0, "DMA not available for this channel"); return 0; }
+    ALWAYS_INLINE DMAChannel* Dma() const { return DMA::ClaimRequest(DmaRequest()); }
 
     static constexpr unsigned CCMR_OFFSET = ((n - 1) & 1) << 3;
     static constexpr uint32_t CCMR_MASK = 0xFF00FF << CCMR_OFFSET;
@@ -160,10 +162,10 @@ using TIM1_t = _TIM<1>;
 
 template<> ALWAYS_INLINE void TIM1_t::EnableClock() const { RCC->APB2ENR |= RCC_APB2ENR_TIM1EN; __DSB(); }
 
-template<> inline DMAChannel* _TIMChannel<1, 1>::Dma() const { return DMA::ClaimChannel({ 0, 2, 7 }); }
-template<> inline DMAChannel* _TIMChannel<1, 2>::Dma() const { return DMA::ClaimChannel({ 0, 3, 7 }); }
-template<> inline DMAChannel* _TIMChannel<1, 3>::Dma() const { return DMA::ClaimChannel({ 0, 7, 7 }); }
-template<> inline DMAChannel* _TIMChannel<1, 4>::Dma() const { return DMA::ClaimChannel({ 0, 4, 7 }); }
+template<> constexpr uint16_t _TIMChannel<1, 1>::DmaRequest() { return DMA::Request(DMA::Spec(0, 2, 7)); }
+template<> constexpr uint16_t _TIMChannel<1, 2>::DmaRequest() { return DMA::Request(DMA::Spec(0, 3, 7)); }
+template<> constexpr uint16_t _TIMChannel<1, 3>::DmaRequest() { return DMA::Request(DMA::Spec(0, 7, 7)); }
+template<> constexpr uint16_t _TIMChannel<1, 4>::DmaRequest() { return DMA::Request(DMA::Spec(0, 4, 7)); }
 
 #endif
 
@@ -174,10 +176,10 @@ using TIM2_t = _TIM<2>;
 
 template<> ALWAYS_INLINE void TIM2_t::EnableClock() const { RCC->APB1ENR1 |= RCC_APB1ENR1_TIM2EN; __DSB(); }
 
-template<> inline DMAChannel* _TIMChannel<2, 1>::Dma() const { return DMA::ClaimChannel({ 0, 5, 4 }); }
-template<> inline DMAChannel* _TIMChannel<2, 2>::Dma() const { return DMA::ClaimChannel({ 0, 7, 4 }); }
-template<> inline DMAChannel* _TIMChannel<2, 3>::Dma() const { return DMA::ClaimChannel({ 0, 1, 4 }); }
-template<> inline DMAChannel* _TIMChannel<2, 4>::Dma() const { return DMA::ClaimChannel({ 0, 7, 4 }); }
+template<> constexpr uint16_t _TIMChannel<2, 1>::DmaRequest() { return DMA::Request(DMA::Spec(0, 5, 4)); }
+template<> constexpr uint16_t _TIMChannel<2, 2>::DmaRequest() { return DMA::Request(DMA::Spec(0, 7, 4)); }
+template<> constexpr uint16_t _TIMChannel<2, 3>::DmaRequest() { return DMA::Request(DMA::Spec(0, 1, 4)); }
+template<> constexpr uint16_t _TIMChannel<2, 4>::DmaRequest() { return DMA::Request(DMA::Spec(0, 7, 4)); }
 
 #endif
 
@@ -188,9 +190,9 @@ using TIM3_t = _TIM<3>;
 
 template<> ALWAYS_INLINE void TIM3_t::EnableClock() const { RCC->APB1ENR1 |= RCC_APB1ENR1_TIM3EN; __DSB(); }
 
-template<> inline DMAChannel* _TIMChannel<3, 1>::Dma() const { return DMA::ClaimChannel({ 0, 6, 5 }); }
-template<> inline DMAChannel* _TIMChannel<3, 3>::Dma() const { return DMA::ClaimChannel({ 0, 2, 5 }); }
-template<> inline DMAChannel* _TIMChannel<3, 4>::Dma() const { return DMA::ClaimChannel({ 0, 3, 5 }); }
+template<> constexpr uint16_t _TIMChannel<3, 1>::DmaRequest() { return DMA::Request(DMA::Spec(0, 6, 5)); }
+template<> constexpr uint16_t _TIMChannel<3, 3>::DmaRequest() { return DMA::Request(DMA::Spec(0, 2, 5)); }
+template<> constexpr uint16_t _TIMChannel<3, 4>::DmaRequest() { return DMA::Request(DMA::Spec(0, 3, 5)); }
 
 #endif
 
@@ -201,9 +203,9 @@ using TIM4_t = _TIM<4>;
 
 template<> ALWAYS_INLINE void TIM4_t::EnableClock() const { RCC->APB1ENR1 |= RCC_APB1ENR1_TIM4EN; __DSB(); }
 
-template<> inline DMAChannel* _TIMChannel<4, 1>::Dma() const { return DMA::ClaimChannel({ 0, 1, 6 }); }
-template<> inline DMAChannel* _TIMChannel<4, 2>::Dma() const { return DMA::ClaimChannel({ 0, 4, 6 }); }
-template<> inline DMAChannel* _TIMChannel<4, 3>::Dma() const { return DMA::ClaimChannel({ 0, 5, 6 }); }
+template<> constexpr uint16_t _TIMChannel<4, 1>::DmaRequest() { return DMA::Request(DMA::Spec(0, 1, 6)); }
+template<> constexpr uint16_t _TIMChannel<4, 2>::DmaRequest() { return DMA::Request(DMA::Spec(0, 4, 6)); }
+template<> constexpr uint16_t _TIMChannel<4, 3>::DmaRequest() { return DMA::Request(DMA::Spec(0, 5, 6)); }
 
 #endif
 
@@ -214,10 +216,10 @@ using TIM5_t = _TIM<5>;
 
 template<> ALWAYS_INLINE void TIM5_t::EnableClock() const { RCC->APB1ENR1 |= RCC_APB1ENR1_TIM5EN; __DSB(); }
 
-template<> inline DMAChannel* _TIMChannel<5, 1>::Dma() const { return DMA::ClaimChannel({ 1, 5, 5 }); }
-template<> inline DMAChannel* _TIMChannel<5, 2>::Dma() const { return DMA::ClaimChannel({ 1, 4, 5 }); }
-template<> inline DMAChannel* _TIMChannel<5, 3>::Dma() const { return DMA::ClaimChannel({ 1, 2, 5 }); }
-template<> inline DMAChannel* _TIMChannel<5, 4>::Dma() const { return DMA::ClaimChannel({ 1, 1, 5 }); }
+template<> constexpr uint16_t _TIMChannel<5, 1>::DmaRequest() { return DMA::Request(DMA::Spec(1, 5, 5)); }
+template<> constexpr uint16_t _TIMChannel<5, 2>::DmaRequest() { return DMA::Request(DMA::Spec(1, 4, 5)); }
+template<> constexpr uint16_t _TIMChannel<5, 3>::DmaRequest() { return DMA::Request(DMA::Spec(1, 2, 5)); }
+template<> constexpr uint16_t _TIMChannel<5, 4>::DmaRequest() { return DMA::Request(DMA::Spec(1, 1, 5)); }
 
 #endif
 
@@ -246,10 +248,10 @@ using TIM8_t = _TIM<8>;
 
 template<> ALWAYS_INLINE void TIM8_t::EnableClock() const { RCC->APB2ENR |= RCC_APB2ENR_TIM8EN; __DSB(); }
 
-template<> inline DMAChannel* _TIMChannel<8, 1>::Dma() const { return DMA::ClaimChannel({ 1, 6, 7 }); }
-template<> inline DMAChannel* _TIMChannel<8, 2>::Dma() const { return DMA::ClaimChannel({ 1, 7, 7 }); }
-template<> inline DMAChannel* _TIMChannel<8, 3>::Dma() const { return DMA::ClaimChannel({ 1, 1, 7 }); }
-template<> inline DMAChannel* _TIMChannel<8, 4>::Dma() const { return DMA::ClaimChannel({ 1, 2, 7 }); }
+template<> constexpr uint16_t _TIMChannel<8, 1>::DmaRequest() { return DMA::Request(DMA::Spec(1, 6, 7)); }
+template<> constexpr uint16_t _TIMChannel<8, 2>::DmaRequest() { return DMA::Request(DMA::Spec(1, 7, 7)); }
+template<> constexpr uint16_t _TIMChannel<8, 3>::DmaRequest() { return DMA::Request(DMA::Spec(1, 1, 7)); }
+template<> constexpr uint16_t _TIMChannel<8, 4>::DmaRequest() { return DMA::Request(DMA::Spec(1, 2, 7)); }
 
 #endif
 
@@ -260,7 +262,7 @@ using TIM15_t = _TIM<15>;
 
 template<> ALWAYS_INLINE void TIM15_t::EnableClock() const { RCC->APB2ENR |= RCC_APB2ENR_TIM15EN; __DSB(); }
 
-template<> inline DMAChannel* _TIMChannel<15, 1>::Dma() const { return DMA::ClaimChannel({ 0, 5, 7 }); }
+template<> constexpr uint16_t _TIMChannel<15, 1>::DmaRequest() { return DMA::Request(DMA::Spec(0, 5, 7)); }
 
 #endif
 
@@ -271,7 +273,7 @@ using TIM16_t = _TIM<16>;
 
 template<> ALWAYS_INLINE void TIM16_t::EnableClock() const { RCC->APB2ENR |= RCC_APB2ENR_TIM16EN; __DSB(); }
 
-template<> inline DMAChannel* _TIMChannel<16, 1>::Dma() const { return DMA::ClaimChannel({ 0, 3, 4 }, { 0, 6, 4 }); }
+template<> constexpr uint16_t _TIMChannel<16, 1>::DmaRequest() { return DMA::Request(DMA::Spec(0, 3, 4), DMA::Spec(0, 6, 4)); }
 
 #endif
 
@@ -282,6 +284,6 @@ using TIM17_t = _TIM<17>;
 
 template<> ALWAYS_INLINE void TIM17_t::EnableClock() const { RCC->APB2ENR |= RCC_APB2ENR_TIM17EN; __DSB(); }
 
-template<> inline DMAChannel* _TIMChannel<17, 1>::Dma() const { return DMA::ClaimChannel({ 0, 1, 5 }, { 0, 7, 5 }); }
+template<> constexpr uint16_t _TIMChannel<17, 1>::DmaRequest() { return DMA::Request(DMA::Spec(0, 1, 5), DMA::Spec(0, 7, 5)); }
 
 #endif
@@ -30,33 +30,257 @@ template<> const GPIOPinTable_t USART3_t::afRx  = GPIO_PINS(pB(11, 7), pC(5, 7),
 template<> const GPIOPinTable_t USART3_t::afCts = GPIO_PINS(pA(6, 7), pB(13, 7), pD(11, 7));
 template<> const GPIOPinTable_t USART3_t::afRts = GPIO_PINS(pB(1, 7), pB(14, 7), pD(2, 7), pD(12, 7));
 
+template<> const GPIOPinTable_t UART4_t::afTx  = GPIO_PINS(pA(0, 8), pC(10, 8));
+template<> const GPIOPinTable_t UART4_t::afRx  = GPIO_PINS(pA(1, 8), pC(11, 8));
+template<> const GPIOPinTable_t UART4_t::afCts = GPIO_PINS(pB(7, 8));
+template<> const GPIOPinTable_t UART4_t::afRts = GPIO_PINS(pA(15, 8));
+
+template<> const GPIOPinTable_t UART5_t::afTx  = GPIO_PINS(pC(12, 8));
+template<> const GPIOPinTable_t UART5_t::afRx  = GPIO_PINS(pD(2, 8));
+template<> const GPIOPinTable_t UART5_t::afCts = GPIO_PINS(pB(5, 8));
+template<> const GPIOPinTable_t UART5_t::afRts = GPIO_PINS(pB(4, 8));
+
+// port G pins require VDDIO2 to be enabled (PWR_CR2_IOSV)
+template<> const GPIOPinTable_t LPUART1_t::afTx  = GPIO_PINS(pB(11, 8), pC(1, 8), pG(7, 8));
+template<> const GPIOPinTable_t LPUART1_t::afRx  = GPIO_PINS(pB(10, 8), pC(0, 8), pG(8, 8));
+template<> const GPIOPinTable_t LPUART1_t::afCts = GPIO_PINS(pB(13, 8), pG(5, 8));
+template<> const GPIOPinTable_t LPUART1_t::afRts = GPIO_PINS(pB(1, 8), pB(12, 8), pG(6, 8));
+
 #pragma endregion
 
-static unsigned diff(unsigned a, unsigned b) { return a > b ? a - b : b - a; }
+uint32_t USART::KernelClock() const
+{
+    switch ((RCC->CCIPR >> (Index() * 2)) & 3)
+    {
+        case KernelClockPCLK: return Index() == 0 ? RCC->PCLK2() : RCC->PCLK1();
+        case KernelClockSYSCLK: return RCC->SYSCLK();
+        case KernelClockHSI16: return 16000000;
+        default: return 32768;
+    }
+}
+
+unsigned USART::BaudRate(unsigned baudRate, uint32_t kernelClock)
+{
+    auto setting = CalculateBaudRate(baudRate, kernelClock, IsLowPower());
+
+    if (IsLowPower())
+    {
+        MYDBG("Setting baud rate to %d (%.4q%% off %d, low-power)",
+            setting.baudRate,
+            int(((float)setting.baudRate / baudRate - 1) * 10000),
+            baudRate);
+    }
+    else
+    {
+        MYDBG("Setting baud rate to %d (%.4q%% off %d, %d-bit oversampling)",
+            setting.baudRate,
+            int(((float)setting.baudRate / baudRate - 1) * 10000),
+            baudRate,
+            setting.over8 ? 8 : 16);
+    }
+
+    BaudRate(setting);
+    return setting.baudRate;
+}
+
+#pragma region Synchronous transfers
+
+const uint8_t USART::SyncTransferDescriptor::s_zero = 0;
+uint8_t USART::SyncTransferDescriptor::s_discard;
+
+// only USART1-3 support the synchronous mode
+static constexpr unsigned SyncCount = 3;
+static constexpr uint16_t s_syncDmaRequests[SyncCount][2] = {
+    { USART1_t::DmaRxRequest(), USART1_t::DmaTxRequest() },
+    { USART2_t::DmaRxRequest(), USART2_t::DmaTxRequest() },
+    { USART3_t::DmaRxRequest(), USART3_t::DmaTxRequest() },
+};
+
+static DMAChannel* s_syncDma[SyncCount][2];
+static volatile uint32_t s_syncCs[SyncCount];
 
-unsigned USART::BaudRate(unsigned baudRate)
+static GPIOPin CsPin(GPIOPinID id) { return GPIOPin(GPIO_P(id.Port()), BIT(id.Pin())); }
+
+bool USART::BindCs(GPIOPinID pin)
 {
-    uint32_t pclk = SystemCoreClock;    // TODO: other clock sources
+    ASSERT(Index() < SyncCount && pin.IsValid());
+    {
+        PLATFORM_CRITICAL_SECTION();
+        if (s_syncCs[Index()])
+        {
+            return false;
+        }
+        s_syncCs[Index()] = pin;
+    }
 
-    uint32_t clkdiv = (pclk + (baudRate >> 1)) / baudRate;
-    uint32_t clkdiv8 = ((pclk << 1) + (baudRate >> 1)) / baudRate;
-    uint32_t finalBaud = pclk / clkdiv;
-    uint32_t finalBaud8 = (pclk << 1) / clkdiv8;
-    bool over8 = false;
+    CsPin(pin).ConfigureDigitalOutput(true);
+    return true;
+}
 
-    if (diff(finalBaud8, baudRate) < diff(finalBaud, baudRate))
+async(USART::BindCs, GPIOPinID pin, Timeout timeout)
+async_def(
+    Timeout timeout;
+)
+{
+    f.timeout = timeout.MakeAbsolute();
+    while (!BindCs(pin))
     {
-        over8 = true;
-        clkdiv = (clkdiv8 & ~0xF) | ((clkdiv8 & 0xF) >> 1);
-        finalBaud = finalBaud8;
+        if (!await_mask_timeout(s_syncCs[Index()], ~0u, 0, f.timeout))
+        {
+            async_return(false);
+        }
     }
+    async_return(true);
+}
+async_end
 
-    MYDBG("Setting baud rate to %d (%.4q%% off %d, %d-bit oversampling)",
-        finalBaud,
-        int(((float)finalBaud / baudRate - 1) * 10000),
-        baudRate,
-        over8 ? 8 : 16);
-    BRR = clkdiv;
-    MODMASK(CR1, USART_CR1_OVER8, USART_CR1_OVER8 * over8);
-    return finalBaud;
+void USART::ReleaseCs()
+{
+    ASSERT(Index() < SyncCount && s_syncCs[Index()]);
+    s_syncCs[Index()] = 0;
 }
+
+async(USART::SyncTransfer, SyncTransferDescriptor* descriptors, size_t count, Timeout timeout)
+async_def(
+    DMAChannel* rx;
+    DMAChannel* tx;
+    SyncTransferDescriptor* next;
+    SyncTransferDescriptor* end;
+    uint32_t cs;
+    volatile uint32_t result;   //< 0 while running, DMA_ISR_TCIF1 on success, DMA_ISR_TEIF1 on error
+
+    void Start()
+    {
+        auto& d = *next;
+        ASSERT(d.rx.CNDTR == d.tx.CNDTR);
+        rx->CMAR = d.rx.CMAR;
+        rx->CNDTR = d.rx.CNDTR;
+        tx->CMAR = d.tx.CMAR;
+        tx->CNDTR = d.tx.CNDTR;
+        rx->CCR = (d.rx.CCR & ~DMA_CCR_EN) | DMA_CCR_TCIE | DMA_CCR_TEIE;
+        tx->CCR = (d.tx.CCR & ~DMA_CCR_EN) | DMA_CCR_TEIE;
+        __DMB();    // make sure the other registers are written before enabling DMA
+        // receive channel first, so that no byte is missed
+        rx->Enable();
+        tx->Enable();
+    }
+
+    void Handler()
+    {
+        // both channels share the handler, only the receive channel signals completion
+        uint32_t rxFlags = rx->DMA().ISR >> (rx->Index() << 2);
+        uint32_t txFlags = tx->DMA().ISR >> (tx->Index() << 2);
+        rx->ClearInterrupt();
+        tx->ClearInterrupt();
+
+        if ((rxFlags | txFlags) & DMA_ISR_TEIF1)
+        {
+            rx->Disable();
+            tx->Disable();
+            result = DMA_ISR_TEIF1;
+        }
+        else if (rxFlags & DMA_ISR_TCIF1)
+        {
+            // the last byte has been received, so it has been transmitted as well
+            rx->Disable();
+            tx->Disable();
+            if (++next != end)
+            {
+                Start();
+            }
+            else
+            {
+                result = DMA_ISR_TCIF1;
+            }
+        }
+    }
+)
+{
+    ASSERT(Index() < SyncCount && (CR2 & USART_CR2_CLKEN));
+    if (!count)
+    {
+        async_return(true);
+    }
+
+    {
+        auto dma = s_syncDma[Index()];
+        if (!dma[0])
+        {
+            auto rx = DMA::ClaimRequest(s_syncDmaRequests[Index()][0], this);
+            auto tx = rx ? DMA::ClaimRequest(s_syncDmaRequests[Index()][1], this) : NULL;
+            if (!tx)
+            {
+                if (rx)
+                {
+                    rx->Release();
+                }
+                MYDBG("DMA not available for sync transfer");
+                async_return(false);
+            }
+            dma[0] = rx;
+            dma[1] = tx;
+        }
+        f.rx = dma[0];
+        f.tx = dma[1];
+    }
+
+    f.rx->CPAR = uint32_t(&RDR);
+    f.tx->CPAR = uint32_t(&TDR);
+    f.next = descriptors;
+    f.end = descriptors + count;
+    f.result = 0;
+
+    f.rx->IRQ().SetHandler(&f, &__FRAME::Handler);
+    f.tx->IRQ().SetHandler(&f, &__FRAME::Handler);
+    f.rx->IRQ().Enable();
+    f.tx->IRQ().Enable();
+
+    // discard anything received before
+    ICR = USART_ICR_ORECF;
+    while (ISR & USART_ISR_RXNE)
+    {
+        (void)RDR;
+    }
+    CR3 |= USART_CR3_DMAR | USART_CR3_DMAT;
+
+    if ((f.cs = s_syncCs[Index()]))
+    {
+        CsPin(f.cs).Res();
+    }
+
+    f.Start();
+    if (!await_mask_not_timeout(f.result, ~0u, 0, timeout))
+    {
+        // abort the chain, the handler must not start the next descriptor
+        f.rx->IRQ().Disable();
+        f.tx->IRQ().Disable();
+        f.rx->Disable();
+        f.tx->Disable();
+        f.rx->ClearInterrupt();
+        f.tx->ClearInterrupt();
+        MYDBG("Sync transfer timeout at descriptor %d", f.next - descriptors);
+    }
+
+    CR3 &= ~(USART_CR3_DMAR | USART_CR3_DMAT);
+
+    if (f.cs)
+    {
+        CsPin(f.cs).Set();
+    }
+
+    f.rx->IRQ().ResetHandler();
+    f.tx->IRQ().ResetHandler();
+
+    if (f.result != DMA_ISR_TCIF1)
+    {
+        if (f.result)
+        {
+            MYDBG("Sync transfer error at descriptor %d", f.next - descriptors);
+        }
+        async_return(false);
+    }
+    async_return(true);
+}
+async_end
+
+#pragma endregion
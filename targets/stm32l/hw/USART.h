@@ -18,8 +18,10 @@
 
 struct USART : USART_TypeDef
 {
-    //! Gets the zero-based index of the peripheral
-    constexpr unsigned Index() const { return unsigned(this) == USART1_BASE ? 0 : ((unsigned(this) >> 10) & 15); }
+    //! Gets the zero-based index of the peripheral, LPUART1 has index 5
+    constexpr unsigned Index() const { return unsigned(this) == USART1_BASE ? 0 : unsigned(this) == LPUART1_BASE ? 5 : ((unsigned(this) >> 10) & 15); }
+    //! Checks whether the peripheral is the low-power UART, which has a different baud rate generator and a reduced feature set
+    constexpr bool IsLowPower() const { return unsigned(this) == LPUART1_BASE; }
 
     struct SyncTransferDescriptor
     {
@@ -31,12 +33,12 @@ struct USART : USART_TypeDef
         void Transmit(Span d)
         {
             rx = DMADescriptor::Transfer((const void*)NULL, &s_discard, d.Length(), DMADescriptor::UnitByte | DMADescriptor::P2M);
-            tx = DMADescriptor::Transfer(d, NULL, d.Length(), DMADescriptor::UnitByte | DMADescriptor::M2P);
+            tx = DMADescriptor::Transfer(d, NULL, d.Length(), DMADescriptor::UnitByte | DMADescriptor::M2P | DMADescriptor::IncrementMemory);
         }
 
         void Receive(Buffer d)
         {
-            rx = DMADescriptor::Transfer((const void*)NULL, d.Pointer(), d.Length(), DMADescriptor::UnitByte | DMADescriptor::P2M);
+            rx = DMADescriptor::Transfer((const void*)NULL, d.Pointer(), d.Length(), DMADescriptor::UnitByte | DMADescriptor::P2M | DMADescriptor::IncrementMemory);
             tx = DMADescriptor::Transfer(&s_zero, NULL, d.Length(), DMADescriptor::UnitByte | DMADescriptor::M2P);
         }
     };
@@ -48,15 +50,84 @@ struct USART : USART_TypeDef
     //! Releases the currently bound CS pin
     void ReleaseCs();
 
-    //! Performs a chain of synchronous transfers
-    async(SyncTransfer, SyncTransferDescriptor* descriptors, size_t count);
+    //! Performs a chain of synchronous transfers, returns false on a DMA transfer error or timeout
+    /*! Only USART1-3 support the synchronous mode, which must be configured using ClockOutput and SPIMode.
+     *  The RX/TX DMA channels are claimed on first use, each descriptor is started directly from
+     *  the DMA interrupt once the previous one completes. The bound CS pin is held low for the whole chain.
+     *  Both channels are stopped if the whole chain does not complete within the timeout. */
+    async(SyncTransfer, SyncTransferDescriptor* descriptors, size_t count, Timeout timeout = Timeout::Infinite);
+
+    //! Baud rate generator setting, see CalculateBaudRate
+    struct BaudRateSetting
+    {
+        uint32_t brr;       //< value of the BRR register
+        bool over8;         //< 8x oversampling is used
+        uint32_t baudRate;  //< resulting baud rate
+    };
+
+    //! Calculates the baud rate generator setting for the specified kernel clock, usable at compile time for fixed configurations
+    /*! 16x oversampling is preferred for its better tolerance to noise and clock deviation,
+     *  8x oversampling is used when it is more precise or the rate is above fck/16, up to fck/8 */
+    static constexpr BaudRateSetting CalculateBaudRate(uint32_t rate, uint32_t kernelClock, bool lowPower = false)
+    {
+        if (lowPower)
+        {
+            // LPUART uses a 256x fractional divider, the kernel clock must be between 3x and 4096x the baud rate
+            ASSERT(kernelClock >= rate * 3 && kernelClock / 4096 <= rate);
+            uint32_t brr = ((uint64_t(kernelClock) << 8) + (rate >> 1)) / rate;
+            return { brr, false, uint32_t((uint64_t(kernelClock) << 8) / brr) };
+        }
+
+        // the divider must be at least 16 and fit in 16 bits in both modes
+        uint32_t div16 = (kernelClock + (rate >> 1)) / rate;
+        uint32_t div8 = ((uint64_t(kernelClock) << 1) + (rate >> 1)) / rate;
+        ASSERT(div8 >= 16 && div16 <= 0xFFFF);
+        uint32_t baud16 = kernelClock / div16;
+        uint32_t baud8 = (uint64_t(kernelClock) << 1) / div8;
+        uint32_t err16 = baud16 > rate ? baud16 - rate : rate - baud16;
+        uint32_t err8 = baud8 > rate ? baud8 - rate : rate - baud8;
 
-    //! Configures the baud rate
-    unsigned BaudRate(unsigned rate);
+        if (div16 < 16 || (div8 <= 0xFFFF && err8 < err16))
+        {
+            // BRR[3] must be zero, the fractional part is shifted
+            return { (div8 & ~0xFu) | ((div8 & 0xF) >> 1), true, baud8 };
+        }
+        return { div16, false, baud16 };
+    }
+
+    //! Configures the baud rate for the currently selected kernel clock
+    unsigned BaudRate(unsigned rate) { return BaudRate(rate, KernelClock()); }
+    //! Configures the baud rate for the specified kernel clock frequency
+    unsigned BaudRate(unsigned rate, uint32_t kernelClock);
+    //! Applies a precalculated baud rate setting, e.g. BaudRate(USART::CalculateBaudRate(4500000, 72000000))
+    void BaudRate(const BaudRateSetting& setting)
+    {
+        BRR = setting.brr;
+        MODMASK(CR1, USART_CR1_OVER8, USART_CR1_OVER8 * setting.over8);
+    }
+
+    enum KernelClockSource
+    {
+        KernelClockPCLK = 0,
+        KernelClockSYSCLK = 1,
+        KernelClockHSI16 = 2,
+        KernelClockLSE = 3,
+    };
+
+    //! Selects the kernel clock in RCC_CCIPR, the peripheral must be disabled
+    //! (the USARTxSEL fields are ordered by index, LPUART1SEL follows UART5SEL)
+    void KernelClock(KernelClockSource source) { MODMASK(RCC->CCIPR, 3u << (Index() * 2), unsigned(source) << (Index() * 2)); }
+    //! Gets the frequency of the kernel clock selected in RCC_CCIPR
+    uint32_t KernelClock() const;
 
     //! Checks whether the peripheral is enabled
     bool IsEnabled() const { return CR1 & USART_CR1_UE; }
 
+    //! Puts the receiver into mute mode, until woken up by the method selected using Mute(MuteMode)
+    void Mute() { RQR = USART_RQR_MMRQ; }
+    //! Checks whether the receiver is in mute mode
+    bool IsMuted() const { return ISR & USART_ISR_RWU; }
+
     #pragma region Configuration registers
 
     using _CR1 = ConfigRegister<&USART_TypeDef::CR1>;
@@ -139,6 +210,8 @@ struct USART : USART_TypeDef
 
     static constexpr auto Address4(uint8_t addr) { return _CR2(uint32_t(addr << USART_CR2_ADD_Pos), USART_CR2_ADD | USART_CR2_ADDM7); }
     static constexpr auto Address7(uint8_t addr) { return _CR2(addr << USART_CR2_ADD_Pos | USART_CR2_ADDM7, USART_CR2_ADD | USART_CR2_ADDM7); }
+    //! Sets the character which sets the CMF flag when received (shares the register field with Address4/Address7)
+    static constexpr auto MatchCharacter(uint8_t ch) { return _CR2(ch << USART_CR2_ADD_Pos | USART_CR2_ADDM7, USART_CR2_ADD | USART_CR2_ADDM7); }
 
     #pragma endregion
 
@@ -191,7 +264,7 @@ struct USART : USART_TypeDef
 
     #pragma endregion
 
-    ALWAYS_INLINE class IRQ IRQ() const { return LOOKUP_TABLE(IRQn_Type, USART1_IRQn, USART2_IRQn, USART3_IRQn, UART4_IRQn, UART5_IRQn)[Index()]; }
+    ALWAYS_INLINE class IRQ IRQ() const { return LOOKUP_TABLE(IRQn_Type, USART1_IRQn, USART2_IRQn, USART3_IRQn, UART4_IRQn, UART5_IRQn, LPUART1_IRQn)[Index()]; }
 
 #if Ckernel
     async_once(RxIdle, Timeout timeout = Timeout::Infinite) { return async_forward(WaitMask, ISR, USART_ISR_BUSY, 0, timeout); }
@@ -222,8 +295,13 @@ struct _USART : USART
     void ConfigureRts(GPIOPin pin, GPIOPin::Mode mode = GPIOPin::SpeedMedium)
         { pin.ConfigureAlternate(afRts, mode); }
 
-    DMAChannel* DmaRx() const;
-    DMAChannel* DmaTx() const;
+    //! Gets the DMA request for receiving, usable with DMAPlan
+    static constexpr uint16_t DmaRxRequest();
+    //! Gets the DMA request for transmitting, usable with DMAPlan
+    static constexpr uint16_t DmaTxRequest();
+
+    DMAChannel* DmaRx() const { return DMA::ClaimRequest(DmaRxRequest()); }
+    DMAChannel* DmaTx() const { return DMA::ClaimRequest(DmaTxRequest()); }
 };
 
 #undef USART1
@@ -231,35 +309,45 @@ using USART1_t = _USART<1>;
 #define USART1  CM_PERIPHERAL(USART1_t, USART1_BASE)
 
 template<> inline void USART1_t::EnableClock() const { RCC->APB2ENR |= RCC_APB2ENR_USART1EN; __DSB(); }
-template<> inline DMAChannel* USART1_t::DmaRx() const { return DMA::ClaimChannel({ 0, 5, 2 }, { 1, 7, 2 }); }
-template<> inline DMAChannel* USART1_t::DmaTx() const { return DMA::ClaimChannel({ 0, 4, 2 }, { 1, 6, 2 }); }
+template<> constexpr uint16_t USART1_t::DmaRxRequest() { return DMA::Request(DMA::Spec(0, 5, 2), DMA::Spec(1, 7, 2)); }
+template<> constexpr uint16_t USART1_t::DmaTxRequest() { return DMA::Request(DMA::Spec(0, 4, 2), DMA::Spec(1, 6, 2)); }
 
 #undef USART2
 using USART2_t = _USART<2>;
 #define USART2  CM_PERIPHERAL(USART2_t, USART2_BASE)
 
 template<> inline void USART2_t::EnableClock() const { RCC->APB1ENR1 |= RCC_APB1ENR1_USART2EN; __DSB(); }
-template<> inline DMAChannel* USART2_t::DmaRx() const { return DMA::ClaimChannel({ 0, 6, 2 }); }
-template<> inline DMAChannel* USART2_t::DmaTx() const { return DMA::ClaimChannel({ 0, 7, 2 }); }
+template<> constexpr uint16_t USART2_t::DmaRxRequest() { return DMA::Request(DMA::Spec(0, 6, 2)); }
+template<> constexpr uint16_t USART2_t::DmaTxRequest() { return DMA::Request(DMA::Spec(0, 7, 2)); }
 
 #undef USART3
 using USART3_t = _USART<3>;
 #define USART3  CM_PERIPHERAL(USART3_t, USART3_BASE)
 
 template<> inline void USART3_t::EnableClock() const { RCC->APB1ENR1 |= RCC_APB1ENR1_USART3EN; __DSB(); }
-template<> inline DMAChannel* USART3_t::DmaRx() const { return DMA::ClaimChannel({ 0, 3, 2 }); }
-template<> inline DMAChannel* USART3_t::DmaTx() const { return DMA::ClaimChannel({ 0, 2, 2 }); }
+template<> constexpr uint16_t USART3_t::DmaRxRequest() { return DMA::Request(DMA::Spec(0, 3, 2)); }
+template<> constexpr uint16_t USART3_t::DmaTxRequest() { return DMA::Request(DMA::Spec(0, 2, 2)); }
 
 #undef UART4
 using UART4_t = _USART<4>;
 #define UART4   CM_PERIPHERAL(UART4_t, UART4_BASE)
 
 template<> inline void UART4_t::EnableClock() const { RCC->APB1ENR1 |= RCC_APB1ENR1_UART4EN; __DSB(); }
-template<> inline DMAChannel* UART4_t::DmaRx() const { return DMA::ClaimChannel({ 1, 5, 2 }); }
-template<> inline DMAChannel* UART4_t::DmaTx() const { return DMA::ClaimChannel({ 1, 3, 2 }); }
+template<> constexpr uint16_t UART4_t::DmaRxRequest() { return DMA::Request(DMA::Spec(1, 5, 2)); }
+template<> constexpr uint16_t UART4_t::DmaTxRequest() { return DMA::Request(DMA::Spec(1, 3, 2)); }
 
 #undef UART5
 using UART5_t = _USART<5>;
-#define UART5   CM_PERIPHERAL(UART5_t, USART5_BASE)
+#define UART5   CM_PERIPHERAL(UART5_t, UART5_BASE)
 
 template<> inline void UART5_t::EnableClock() const { RCC->APB1ENR1 |= RCC_APB1ENR1_UART5EN; __DSB(); }
+template<> constexpr uint16_t UART5_t::DmaRxRequest() { return DMA::Request(DMA::Spec(1, 2, 2)); }
+template<> constexpr uint16_t UART5_t::DmaTxRequest() { return DMA::Request(DMA::Spec(1, 1, 2)); }
+
+#undef LPUART1
+using LPUART1_t = _USART<6>;
+#define LPUART1 CM_PERIPHERAL(LPUART1_t, LPUART1_BASE)
+
+template<> inline void LPUART1_t::EnableClock() const { RCC->APB1ENR2 |= RCC_APB1ENR2_LPUART1EN; __DSB(); }
+template<> constexpr uint16_t LPUART1_t::DmaRxRequest() { return DMA::Request(DMA::Spec(1, 7, 4)); }
+template<> constexpr uint16_t LPUART1_t::DmaTxRequest() { return DMA::Request(DMA::Spec(1, 6, 4)); }
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2024 triaxis s.r.o.
+ * Licensed under the MIT license. See LICENSE.txt file in the repository root
+ * for full license information.
+ *
+ * stm32l/io/DMABridge.cpp
+ */
+
+#include "DMABridge.h"
+
+namespace io
+{
+
+DMABridge::DMABridge(DMAChannel& rx, const volatile void* source, DMAChannel& tx, volatile void* destination, Buffer ring, DMADescriptor::Flags flags)
+    : rx(rx), tx(tx), irq(rx.IRQ()), ring(ring.Pointer()), size(ring.Length()), pos(0), tap(NULL), tapContext(NULL), forwarded(0), stalls(0)
+{
+    tx.CPAR = uint32_t(destination);
+    tx.CCR = flags | DMADescriptor::M2P | DMADescriptor::IncrementMemory | DMADescriptor::UnitByte;
+
+    // the handler links to the transmit channel, so it must run at the same priority as the link handler
+    irq.SetHandler(this, &DMABridge::Handler);
+    irq.Priority(CORTEX_MAXIMUM_PRIO);
+    irq.Enable();
+    rx.CPAR = uint32_t(source);
+    rx.CMAR = uint32_t(this->ring);
+    rx.CNDTR = size;
+    rx.CCR = flags | DMADescriptor::P2M | DMADescriptor::IncrementMemory | DMADescriptor::UnitByte | DMADescriptor::Circular |
+        DMADescriptor::InterruptHalf | DMADescriptor::InterruptComplete | DMADescriptor::Start;
+}
+
+DMABridge::~DMABridge()
+{
+    irq.Disable();
+    rx.Disable();
+    rx.ClearInterrupt();
+    // the handler must not be left pointing to the destroyed bridge
+    irq.ResetHandler();
+    tx.Unlink();
+}
+
+void DMABridge::SetTap(Tap tap, void* context)
+{
+    irq.Disable();
+    this->tap = tap;
+    tapContext = context;
+    irq.Enable();
+}
+
+void DMABridge::Flush()
+{
+    irq.Disable();
+    Forward();
+    irq.Enable();
+}
+
+void DMABridge::Forward()
+{
+    // CNDTR reloads to size on wrap, which correctly maps to the start of the ring
+    size_t w = size - rx.CNDTR;
+    while (pos != w)
+    {
+        Span block(ring + pos, (w > pos ? w : size) - pos);
+        size_t linked = tx.TryLinkBuffer(block);
+        if (linked && tap)
+        {
+            tap(tapContext, block.Left(linked));
+        }
+        forwarded += linked;
+        if ((pos += linked) == size)
+        {
+            pos = 0;
+        }
+        if (linked < block.Length())
+        {
+            // transmit queue full, the rest will be forwarded on the next interrupt
+            stalls++;
+            break;
+        }
+    }
+}
+
+void DMABridge::Handler()
+{
+    rx.ClearInterrupt();
+    Forward();
+}
+
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2024 triaxis s.r.o.
+ * Licensed under the MIT license. See LICENSE.txt file in the repository root
+ * for full license information.
+ *
+ * stm32l/io/DMABridge.h
+ *
+ * Peripheral-to-peripheral forwarding entirely in DMA.
+ *
+ * The receiving channel writes into a small circular staging ring, and the
+ * received regions of the ring are linked to the transmitting channel from the
+ * half/full transfer interrupt, so no task is involved in forwarding the data.
+ * The ring must be large enough to cover the difference between the receive
+ * and transmit rates, otherwise the data is overwritten before it is sent.
+ *
+ * Data is forwarded at half and end of the ring, call Flush (e.g. on idle line)
+ * to forward a partial block with lower latency.
+ *
+ * When the destination is always able to keep up with the source and no
+ * monitoring is needed, DMADescriptor::Bridge can be used instead, requiring
+ * just a single channel and no staging buffer at all.
+ */
+
+#pragma once
+
+#include <base/base.h>
+#include <base/Span.h>
+
+#include <hw/DMA.h>
+
+namespace io
+{
+
+class DMABridge
+{
+public:
+    //! Callback invoked from the interrupt handler with every forwarded block
+    typedef void (*Tap)(void* context, Span data);
+
+    DMABridge(DMAChannel& rx, const volatile void* source, DMAChannel& tx, volatile void* destination, Buffer ring, DMADescriptor::Flags flags = {});
+    ~DMABridge();
+
+    //! Sets a callback that gets to see all the forwarded data, called from interrupt context
+    void SetTap(Tap tap, void* context = NULL);
+    //! Forwards the data received so far without waiting for the half/full transfer interrupt
+    void Flush();
+
+    //! Gets the total number of forwarded bytes
+    uint32_t Forwarded() const { return forwarded; }
+    //! Gets the number of times forwarding had to be postponed because the transmit queue was full
+    uint32_t Stalls() const { return stalls; }
+
+private:
+    DMAChannel& rx;
+    DMAChannel& tx;
+    IRQ irq;
+    char* ring;
+    size_t size;
+    size_t pos;             //< offset of the first byte in the ring not yet forwarded
+    Tap tap;
+    void* tapContext;
+    uint32_t forwarded;
+    uint32_t stalls;
+
+    void Forward();
+    void Handler();
+};
+
+inline DMABridge* CreateDMABridgeWithBuffer(DMAChannel& rx, const volatile void* source, DMAChannel& tx, volatile void* destination, size_t bufferSize, DMADescriptor::Flags flags = {})
+{
+    char* mem = new char[sizeof(DMABridge) + bufferSize];
+    Buffer buf(mem + sizeof(DMABridge), bufferSize);
+    return new(mem) DMABridge(rx, source, tx, destination, buf, flags);
+}
+
+}
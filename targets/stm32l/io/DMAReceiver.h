@@ -10,6 +10,11 @@
  * Data is transferred directly into pipe buffers, saving some overhead.
  * Suitable for all but high transfer speeds - there is a short time when
  * buffer linking takes place and data can be lost before DMA is ready again.
+ *
+ * Half-word or word transfers (e.g. for 9-bit USART frames) can be used
+ * by passing DMADescriptor::UnitHalfWord or UnitWord in flags. Units split
+ * between pipe buffers are received through a staging word, which is slower,
+ * so buffers should preferably be sized and aligned to whole units.
  */
 
 #pragma once
@@ -21,7 +26,7 @@
 namespace io
 {
 
-class DMAReceiver : public Receiver
+class DMAReceiver final : public Receiver
 {
 public:
     DMAReceiver(DMAChannel& dma, const volatile void* source, DMADescriptor::Flags flags = {})
@@ -31,6 +36,17 @@ public:
         dma.CCR = flags | DMADescriptor::P2M | DMADescriptor::IncrementMemory | DMADescriptor::UnitByte;
     }
 
+    //! Makes Wait sleep until the returned counter changes instead of polling the DMA transfer count
+    /*! The counter is incremented on half and full transfer of each buffer, other events
+     *  (e.g. USART idle line) should increment it as well to wake the receiver earlier.
+     *  Must be called before the receiver is started. */
+    volatile uint32_t& UseWakeCounter()
+    {
+        ASSERT(!dma.IsEnabled());
+        dma.CCR |= DMADescriptor::InterruptHalf;
+        return dma.LinkProgress();
+    }
+
 protected:
     virtual size_t TryAddBuffer(size_t offset, Buffer buffer);
     virtual const char* GetWritePointer(Buffer buffer);
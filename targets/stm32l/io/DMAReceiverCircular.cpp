@@ -22,45 +22,41 @@ size_t DMAReceiverCircular::TryAddBuffer(size_t offset, Buffer buf)
 const char* DMAReceiverCircular::GetWritePointer(Buffer buf)
 {
     // this is actually the point where we load the destination buffer with received data
-    auto end = this->end, r = this->r;
-    char* w = end - dma.CNDTR;  // next write position
-
-    if (w == r || buf.Length() == 0)
+    while (buf.Length())
     {
-        // no new data or no buffer space
-        return buf.Pointer();
-    }
-
-    if (w < r)
-    {
-        // write index is before read index, so the part to the end of the buffer is filled
-        if (size_t block = std::min(size_t(end - r), buf.Length()))
+        auto block = Peek().Left(buf.Length());
+        if (!block.Length())
         {
-            memcpy(buf.Pointer(), r, block);
-            buf = buf.RemoveLeft(block);
-            if ((r += block) == end)
-            {
-                r = (char*)dma.CMAR;
-            }
+            // no new data
+            break;
         }
-    }
-    if (r < w)
-    {
-        if (size_t block = std::min(size_t(w - r), buf.Length()))
+
+        memcpy(buf.Pointer(), block.Pointer(), block.Length());
+        if (!Release(block.Length()))
         {
-            memcpy(buf.Pointer(), r, block);
-            buf = buf.RemoveLeft(block);
-            r += block;
-            ASSERT(r < end);    // cannot happen
+            // the data has been overwritten while copying, drop it
+            break;
         }
+        buf = buf.RemoveLeft(block.Length());
     }
 
-    this->r = r;
     return buf.Pointer();
 }
 
 async_once(DMAReceiverCircular::Wait, const char* current, Timeout timeout)
 {
+    if (signalled)
+    {
+        // capture the counter before checking for data so no event gets lost
+        uint32_t wake = this->wake;
+        uint32_t cndtr;
+        if (Received(cndtr) != consumed)
+        {
+            async_once_return(true);
+        }
+        return async_forward(WaitMaskNot, this->wake, ~0u, wake, timeout);
+    }
+
     return async_forward(WaitMaskNot, dma.CNDTR, ~0u, end - r, timeout);
 }
 
@@ -69,4 +65,69 @@ async_once(DMAReceiverCircular::Close)
     async_once_return(0);
 }
 
-}
\ No newline at end of file
+uint32_t DMAReceiverCircular::Received(uint32_t& cndtr)
+{
+    irq.Disable();
+    cndtr = dma.CNDTR;
+    uint32_t laps = this->laps;
+    if (dma.DMA().ISR & (DMA_ISR_TCIF1 << (dma.Index() << 2)))
+    {
+        // wrapped around, but the handler hasn't run yet - CNDTR may have been read either
+        // before or after the wrap, read it again to be sure
+        cndtr = dma.CNDTR;
+        laps++;
+    }
+    irq.Enable();
+    size_t size = Size();
+    return laps * size + (size - cndtr);
+}
+
+Span DMAReceiverCircular::Peek()
+{
+    uint32_t cndtr;
+    uint32_t received = Received(cndtr);
+    uint32_t available = received - consumed;
+
+    if (available > Size())
+    {
+        // the DMA has lapped the reader, all unread data is lost
+        overruns++;
+        consumed = received;
+        r = end - cndtr;
+        return {};
+    }
+
+    return Span(r, std::min(size_t(end - r), size_t(available)));
+}
+
+bool DMAReceiverCircular::Release(size_t count)
+{
+    ASSERT(count <= size_t(end - r));
+    consumed += count;
+    if ((r += count) == end)
+    {
+        r = (char*)dma.CMAR;
+    }
+
+    // make sure the DMA did not overwrite the data while it was being consumed
+    uint32_t cndtr;
+    if (Received(cndtr) - consumed > Size() - count)
+    {
+        overruns++;
+        return false;
+    }
+    return true;
+}
+
+void DMAReceiverCircular::Handler()
+{
+    uint32_t flags = dma.DMA().ISR >> (dma.Index() << 2);
+    dma.ClearInterrupt();
+    if (flags & DMA_ISR_TCIF1)
+    {
+        laps++;
+    }
+    wake++;
+}
+
+}
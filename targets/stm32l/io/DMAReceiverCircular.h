@@ -10,6 +10,9 @@
  * This is the only strategy allowing continuous high-speed transfers without
  * hardware flow control. The main disadvantage is that it requires a dedicated
  * buffer and an extra copying step.
+ *
+ * The copying can be avoided by not connecting the receiver to a pipe and
+ * consuming the data directly from the ring using Peek/Release instead.
  */
 
 #pragma once
@@ -21,19 +24,38 @@
 namespace io
 {
 
-class DMAReceiverCircular : public Receiver
+class DMAReceiverCircular final : public Receiver
 {
 public:
     DMAReceiverCircular(DMAChannel& dma, const volatile void* source, Buffer buffer, DMADescriptor::Flags flags = {})
-        : dma(dma)
+        : dma(dma), irq(dma.IRQ()), laps(0), consumed(0), overruns(0), wake(0), signalled(false)
     {
+        irq.SetHandler(this, &DMAReceiverCircular::Handler);
+        irq.Priority(CORTEX_MAXIMUM_PRIO);
+        irq.Enable();
         dma.CPAR = uint32_t(source);
         dma.CMAR = uint32_t(r = buffer.Pointer());
         dma.CNDTR = buffer.Length();
-        dma.CCR = flags | DMADescriptor::P2M | DMADescriptor::IncrementMemory | DMADescriptor::UnitByte | DMADescriptor::Circular | DMADescriptor::Start;
+        dma.CCR = flags | DMADescriptor::P2M | DMADescriptor::IncrementMemory | DMADescriptor::UnitByte | DMADescriptor::Circular |
+            DMADescriptor::InterruptHalf | DMADescriptor::InterruptComplete | DMADescriptor::Start;
         end = buffer.end();
     }
 
+    //! Gets the contiguous block of received data at the read position, without copying it
+    /*! The block ends at the end of the ring, the rest is returned after the block is released */
+    Span Peek();
+    //! Releases the specified number of bytes at the beginning of the block returned by Peek
+    /*! Returns false if the released data has been overwritten by the DMA in the meantime */
+    bool Release(size_t count);
+    //! Waits until there is data available to Peek
+    async_once(WaitAvailable, Timeout timeout = Timeout::Infinite) { return async_forward(Wait, NULL, timeout); }
+    //! Gets the number of times the DMA write pointer lapped the reader
+    uint32_t Overruns() const { return overruns; }
+    //! Makes Wait sleep until the returned counter changes instead of polling the DMA transfer count
+    /*! The counter is incremented on half and full transfer of the ring, other events
+     *  (e.g. USART idle line) should increment it as well to wake the receiver earlier */
+    volatile uint32_t& UseWakeCounter() { signalled = true; return wake; }
+
 protected:
     virtual size_t TryAddBuffer(size_t offset, Buffer buffer);
     virtual const char* GetWritePointer(Buffer buf);
@@ -42,8 +64,19 @@ protected:
 
 private:
     DMAChannel& dma;
+    IRQ irq;
     char* end;
     char* r;
+    uint32_t laps;          //< number of times the DMA wrapped around, updated by the interrupt handler
+    uint32_t consumed;      //< total number of bytes consumed, modulo 2^32
+    uint32_t overruns;
+    volatile uint32_t wake; //< incremented on every interrupt
+    bool signalled;         //< Wait sleeps until wake changes instead of polling CNDTR
+
+    size_t Size() const { return end - (char*)dma.CMAR; }
+    //! Gets the total number of bytes received, modulo 2^32, along with the matching CNDTR value
+    uint32_t Received(uint32_t& cndtr);
+    void Handler();
 };
 
 inline DMAReceiverCircular* CreateDMAReceiverCircularWithBuffer(DMAChannel& dma, const volatile void* source, size_t bufferSize, DMADescriptor::Flags flags = {})
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2024 triaxis s.r.o.
+ * Licensed under the MIT license. See LICENSE.txt file in the repository root
+ * for full license information.
+ *
+ * stm32l/io/DMAReceiverPingPong.cpp
+ */
+
+#include "DMAReceiverPingPong.h"
+
+namespace io
+{
+
+size_t DMAReceiverPingPong::TryAddBuffer(size_t offset, Buffer buf)
+{
+    size_t res = buf.Length();
+
+    irq.Disable();
+    if (!end)
+    {
+        // nothing running, start immediately
+        Start(buf.begin(), buf.begin(), buf.end());
+    }
+    else if (!next)
+    {
+        // set next buffer
+        next = buf.begin();
+        nextEnd = buf.end();
+    }
+    else if (nextEnd == buf.begin())
+    {
+        // extend next buffer
+        nextEnd = buf.end();
+    }
+    else
+    {
+        res = 0;
+    }
+    irq.Enable();
+
+    return res;
+}
+
+const char* DMAReceiverPingPong::GetWritePointer(Buffer buf)
+{
+    irq.Disable();
+    auto start = this->start, end = this->end, next = this->next, nextEnd = this->nextEnd;
+    uint32_t cndtr = dma.CNDTR;
+    // the flag must be checked after reading CNDTR, otherwise a wrap could go unnoticed
+    bool wrapped = dma.DMA().ISR & (DMA_ISR_TCIF1 << (dma.Index() << 2));
+    irq.Enable();
+
+    auto p = buf.Pointer();
+    if (p >= start && p <= end)
+    {
+        // the beginning of the buffer may be overwritten until the handler switches buffers
+        return wrapped ? p : std::max(p, end - cndtr);
+    }
+
+    if (p >= next && p <= nextEnd)
+    {
+        // not started yet
+        return p;
+    }
+
+    // the transfer has already moved past the buffer
+    return buf.end();
+}
+
+async_once(DMAReceiverPingPong::Wait, const char* current, Timeout timeout)
+{
+    auto end = this->end;
+    if (!end)
+    {
+        // we cannot reliably wait for inactive DMA to change - just yield and try again
+        __pCallee.waitResult = {};
+        return _ASYNC_RES(0, AsyncResult::SleepTicks);
+    }
+
+    // capture the counter before checking for data so no event gets lost
+    uint32_t wake = this->wake;
+    uint32_t cndtr = dma.CNDTR;
+    if (end - cndtr != current)
+    {
+        async_once_return(true);
+    }
+    if (signalled)
+    {
+        return async_forward(WaitMaskNot, this->wake, ~0u, wake, timeout);
+    }
+    return async_forward(WaitMaskNot, dma.CNDTR, ~0u, cndtr, timeout);
+}
+
+async_once(DMAReceiverPingPong::Close)
+{
+    irq.Disable();
+    dma.Disable();
+    dma.ClearInterrupt();
+    start = base = end = next = nextEnd = NULL;
+    irq.Enable();
+    async_once_return(0);
+}
+
+void DMAReceiverPingPong::Start(char* start, char* base, char* end)
+{
+    ASSERT(base < end);
+    dma.CMAR = uint32_t(base);
+    dma.CNDTR = end - base;
+    __DMB();    // make sure the other registers are written before enabling DMA
+    dma.CCR = ccr;
+    this->start = start;
+    this->base = base;
+    this->end = end;
+    guarded = 0;
+}
+
+OPTIMIZE void DMAReceiverPingPong::Handler()
+{
+    uint32_t flags = dma.DMA().ISR >> (dma.Index() << 2);
+    dma.ClearInterrupt();
+    wake++;
+
+    if (flags & DMA_ISR_TCIF1)
+    {
+        // the channel cannot be retargeted while enabled, the USART keeps the pending
+        // character in RDR, so nothing is lost if the channel is re-armed within one character time
+        dma.Disable();
+        auto base = this->base;
+        size_t wrapped = (end - base) - dma.CNDTR;
+        size_t carry = 0;
+
+        if (next)
+        {
+            // continue to the next buffer immediately, leaving space for the wrapped bytes
+            carry = std::min(wrapped, size_t(nextEnd - next) - 1);
+            auto nextStart = next;
+            Start(nextStart, nextStart + carry, nextEnd);
+            next = nextEnd = NULL;
+            memcpy(nextStart, base, carry);
+        }
+        else
+        {
+            // no buffer to continue to
+            start = this->base = end = NULL;
+        }
+
+        // restore the overwritten data, anything past the guard has already been
+        // published and cannot be restored - it must be reported to the reader
+        size_t restore = std::min(wrapped, guarded);
+        memcpy(base, guard, restore);
+        overrun += wrapped - carry;
+        damaged += wrapped - restore;
+        return;
+    }
+
+    if (flags & DMA_ISR_HTIF1)
+    {
+        // the beginning of the circular region is filled, keep a copy
+        // of it in case the transfer wraps before we manage to switch buffers
+        guarded = std::min(GuardSize, size_t(end - base) >> 1);
+        memcpy(guard, base, guarded);
+    }
+}
+
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2024 triaxis s.r.o.
+ * Licensed under the MIT license. See LICENSE.txt file in the repository root
+ * for full license information.
+ *
+ * stm32l/io/DMAReceiverPingPong.h
+ *
+ * A receiver strategy using circular DMA transfers over pipe buffers.
+ *
+ * Data is transferred directly into pipe buffers like with DMAReceiver, but
+ * the channel runs in circular mode, so it keeps accepting characters even
+ * when the switch to the next buffer is late. Characters received before
+ * the transfer complete interrupt switches to the next buffer land at the start
+ * of the current one and are moved to the next buffer by the handler,
+ * the overwritten data is restored from a copy taken in the half transfer
+ * interrupt.
+ *
+ * The STM32L4 DMA cannot retarget a running channel, so the switch itself
+ * briefly disables it, this is harmless as long as it happens within one
+ * character time (the USART holds the pending character). If the handler
+ * is delayed by more than GuardSize characters, the wrapped data cannot be
+ * fully restored and characters the reader may not have consumed yet are
+ * damaged. This is reported by Damaged(), readers that cannot tolerate it
+ * must check it or use DMAReceiverCircular instead.
+ */
+
+#pragma once
+
+#include <io/Receiver.h>
+
+#include <hw/DMA.h>
+
+namespace io
+{
+
+class DMAReceiverPingPong final : public Receiver
+{
+public:
+    DMAReceiverPingPong(DMAChannel& dma, const volatile void* source, DMADescriptor::Flags flags = {})
+        : dma(dma), irq(dma.IRQ()),
+        ccr(flags | DMADescriptor::P2M | DMADescriptor::IncrementMemory | DMADescriptor::UnitByte | DMADescriptor::Circular |
+            DMADescriptor::InterruptHalf | DMADescriptor::InterruptComplete | DMADescriptor::Start),
+        start{}, base{}, end{}, next{}, nextEnd{}, guarded{}, overrun{}, damaged{}, wake{}, signalled{}
+    {
+        dma.CPAR = uint32_t(source);
+        irq.SetHandler(this, &DMAReceiverPingPong::Handler);
+        irq.Priority(CORTEX_MAXIMUM_PRIO);
+        irq.Enable();
+    }
+
+    //! Maximum number of characters that can be received between the end of a buffer and the switch to the next one
+    static constexpr size_t GuardSize = 4;
+
+    //! Gets the number of bytes lost because no buffer was ready or the switch took too long
+    size_t Overrun() const { return overrun; }
+    //! Gets the number of already published bytes overwritten because the switch took longer than GuardSize characters
+    /*! Any non-zero value means the data delivered to the pipe is not reliable */
+    size_t Damaged() const { return damaged; }
+    //! Makes Wait sleep until the returned counter changes instead of polling the DMA transfer count
+    /*! The counter is incremented on half and full transfer, other events
+     *  (e.g. USART idle line) should increment it as well to wake the receiver earlier */
+    volatile uint32_t& UseWakeCounter() { signalled = true; return wake; }
+
+protected:
+    virtual size_t TryAddBuffer(size_t offset, Buffer buffer);
+    virtual const char* GetWritePointer(Buffer buffer);
+    virtual async_once(Wait, const char* current, Timeout timeout = Timeout::Infinite);
+    virtual async_once(Close);
+
+private:
+    DMAChannel& dma;
+    IRQ irq;
+    uint32_t ccr;
+    char* start;            //< start of the buffer being filled
+    char* base;             //< start of the circular transfer in the current buffer
+    char* end;              //< end of the buffer being filled
+    char* next;             //< start of the next buffer
+    char* nextEnd;          //< end of the next buffer
+    size_t guarded;         //< number of bytes saved in the guard
+    size_t overrun;
+    size_t damaged;         //< published bytes that could not be restored after a late switch
+    volatile uint32_t wake; //< incremented on every interrupt
+    bool signalled;         //< Wait sleeps until wake changes instead of polling CNDTR
+    char guard[GuardSize];  //< copy of the data at base, which gets overwritten when the transfer wraps
+
+    void Start(char* start, char* base, char* end);
+    void Handler();
+};
+
+}
@@ -8,6 +8,12 @@
  * A transmitter strategy using DMA buffer linking.
  *
  * Recommended for most scenarios.
+ *
+ * Half-word or word transfers (e.g. for 9-bit USART frames or timer compare
+ * values) can be used by passing DMADescriptor::UnitHalfWord or UnitWord
+ * in flags. Units split between pipe blocks (or misaligned) are transmitted
+ * one at a time through a staging word, so blocks should preferably be
+ * written in whole units.
  */
 
 #pragma once
@@ -26,7 +32,8 @@ public:
         : dma(dma)
     {
         dma.CPAR = uint32_t(destination);
-        dma.CCR = flags | DMADescriptor::M2P | DMADescriptor::IncrementMemory | DMADescriptor::UnitByte;
+        // the half transfer interrupt wakes the pipe task to release the transmitted part of long blocks
+        dma.CCR = flags | DMADescriptor::M2P | DMADescriptor::IncrementMemory | DMADescriptor::UnitByte | DMADescriptor::InterruptHalf;
     }
 
 protected:
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2024 triaxis s.r.o.
+ * Licensed under the MIT license. See LICENSE.txt file in the repository root
+ * for full license information.
+ *
+ * stm32l/io/DMATransmitterCircular.cpp
+ */
+
+#include "DMATransmitterCircular.h"
+
+namespace io
+{
+
+size_t DMATransmitterCircular::Write(Span data)
+{
+    size_t w = this->w;
+    size_t len = std::min(Free(), data.Length());
+    size_t first = std::min(len, size - w);
+    memcpy(buf + w, data.Pointer(), first);
+    memcpy(buf, data.Pointer() + first, len - first);
+    if ((w += len) >= size)
+    {
+        w -= size;
+    }
+    __DMB();    // make sure the data is in memory before the DMA can see it
+    this->w = w;
+
+    if (len && !dma.IsEnabled())
+    {
+        // let the handler start the transfer
+        irq.Trigger();
+    }
+    return len;
+}
+
+bool DMATransmitterCircular::Pump()
+{
+    pending = pending.RemoveLeft(Write(pending));
+    return pending.Length();
+}
+
+size_t DMATransmitterCircular::TryAddBlock(Span block)
+{
+    if (Pump())
+    {
+        // the previous block has not been copied completely yet
+        return 0;
+    }
+
+    pending = block;
+    Pump();
+    return block.Length();
+}
+
+const char* DMATransmitterCircular::GetReadPointer()
+{
+    Pump();
+    // no block has been added yet, report the start of the ring
+    return pending.Pointer() ? pending.Pointer() : buf;
+}
+
+async_once(DMATransmitterCircular::Wait, const char* current, Timeout timeout)
+{
+    // capture the counter before pumping so no progress gets lost
+    uint32_t progress = this->progress;
+    if (GetReadPointer() != current)
+    {
+        async_once_return(true);
+    }
+
+    // only the DMA freeing space in the ring can let more of the block in
+    return async_forward(WaitMaskNot, this->progress, ~0u, progress, timeout);
+}
+
+void DMATransmitterCircular::Handler()
+{
+    uint32_t flags = dma.DMA().ISR >> (dma.Index() << 2);
+    dma.ClearInterrupt();
+
+    size_t done = 0;
+    if (flags & (DMA_ISR_TCIF1 | DMA_ISR_TEIF1))
+    {
+        // the transfer is over, either way
+        dma.Disable();
+        done = running;
+    }
+    else if (flags & DMA_ISR_HTIF1)
+    {
+        done = running - dma.CNDTR;
+    }
+
+    if (done)
+    {
+        size_t r = this->r + done;
+        this->r = r >= size ? r - size : r;
+        running -= done;
+        progress++;
+    }
+
+    if (!dma.IsEnabled())
+    {
+        size_t r = this->r, w = this->w;
+        if (r != w)
+        {
+            // transmit the next contiguous region of the ring
+            running = (w > r ? w : size) - r;
+            dma.CMAR = uint32_t(buf + r);
+            dma.CNDTR = running;
+            dma.ClearAndEnable();
+        }
+    }
+}
+
+}
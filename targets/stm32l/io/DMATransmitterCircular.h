@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2024 triaxis s.r.o.
+ * Licensed under the MIT license. See LICENSE.txt file in the repository root
+ * for full license information.
+ *
+ * stm32l/io/DMATransmitterCircular.h
+ *
+ * A transmitter strategy using a dedicated ring buffer.
+ *
+ * Producers append data using Write, which is a constant-time copy into the
+ * ring with no per-write linking overhead, making it suitable for bursty
+ * producers of short writes (e.g. logging). Pipe blocks are copied into the
+ * ring as well, so the strategy can be used as a regular transmitter.
+ *
+ * The DMA cannot run in hardware circular mode, as it would keep transmitting
+ * stale data past the write position, so the contiguous regions of the ring
+ * are transferred one after another, restarted directly from the interrupt
+ * handler. The read position is advanced on both half and full transfer.
+ *
+ * Write is not reentrant, there must be a single producer at a time.
+ */
+
+#pragma once
+
+#include <io/Transmitter.h>
+
+#include <hw/DMA.h>
+
+namespace io
+{
+
+class DMATransmitterCircular final : public Transmitter
+{
+public:
+    DMATransmitterCircular(DMAChannel& dma, volatile void* destination, Buffer buffer, DMADescriptor::Flags flags = {})
+        : dma(dma), irq(dma.IRQ()), buf(buffer.Pointer()), size(buffer.Length()), r(0), w(0), running(0), progress(0)
+    {
+        dma.CPAR = uint32_t(destination);
+        dma.CCR = flags | DMADescriptor::M2P | DMADescriptor::IncrementMemory | DMADescriptor::UnitByte |
+            DMADescriptor::InterruptHalf | DMADescriptor::InterruptComplete;
+        irq.SetHandler(this, &DMATransmitterCircular::Handler);
+        irq.Priority(CORTEX_MAXIMUM_PRIO);
+        irq.Enable();
+    }
+
+    //! Appends as much of the data as fits into the ring, returns the number of bytes written
+    size_t Write(Span data);
+    //! Gets the number of bytes that can be written without blocking
+    size_t Free() const { return (r + size - w - 1) % size; }
+    //! Waits until the DMA makes progress, freeing some space in the ring
+    async_once(WaitProgress, Timeout timeout = Timeout::Infinite) { return async_forward(WaitMaskNot, progress, ~0u, progress, timeout); }
+
+protected:
+    virtual size_t TryAddBlock(Span block);
+    virtual const char* GetReadPointer();
+    virtual async_once(Wait, const char* current, Timeout timeout = Timeout::Infinite);
+
+private:
+    DMAChannel& dma;
+    IRQ irq;
+    char* buf;
+    size_t size;
+    volatile size_t r;          //< read offset, updated by the interrupt handler
+    volatile size_t w;          //< write offset, updated by the producer
+    size_t running;             //< bytes of the running transfer not yet accounted for in r
+    volatile uint32_t progress; //< incremented on every transfer interrupt
+    Span pending;               //< part of the last pipe block not yet copied into the ring
+
+    //! Copies as much of the pending pipe block as possible, returns true if some data remains
+    bool Pump();
+    void Handler();
+};
+
+inline DMATransmitterCircular* CreateDMATransmitterCircularWithBuffer(DMAChannel& dma, volatile void* destination, size_t bufferSize, DMADescriptor::Flags flags = {})
+{
+    char* mem = new char[sizeof(DMATransmitterCircular) + bufferSize];
+    Buffer buf(mem + sizeof(DMATransmitterCircular), bufferSize);
+    return new(mem) DMATransmitterCircular(dma, destination, buf, flags);
+}
+
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2024 triaxis s.r.o.
+ * Licensed under the MIT license. See LICENSE.txt file in the repository root
+ * for full license information.
+ *
+ * stm32l/io/RS485Pipe.cpp
+ */
+
+#include "RS485Pipe.h"
+
+namespace io
+{
+
+void RS485Pipe::Init(unsigned assertTime, unsigned deassertTime, bool invertDe)
+{
+    ASSERT(assertTime < 32 && deassertTime < 32);
+    transmitting = waiting = false;
+    txStart = txEnd = txTime = responseTime = 0;
+    transactions = 0;
+
+    // the DE configuration can be changed only while the USART is disabled
+    auto ue = usart.CR1 & USART_CR1_UE;
+    usart.CR1 &= ~USART_CR1_UE;
+    MODMASK(usart.CR1, USART_CR1_DEAT | USART_CR1_DEDT, assertTime << USART_CR1_DEAT_Pos | deassertTime << USART_CR1_DEDT_Pos);
+    MODMASK(usart.CR3, USART_CR3_DEM | USART_CR3_DEP, USART_CR3_DEM | USART_CR3_DEP * invertDe);
+    usart.CR1 |= ue;
+
+    // the end of a response is detected by the idle line event
+    receiver.WakeOn(true);
+    auto& events = USARTInterrupt::Get(&usart);
+    events.HandleTxComplete(&RS485Pipe::TxComplete, this);
+    events.HandleRx(&RS485Pipe::RxEvent, this);
+}
+
+RS485Pipe::~RS485Pipe()
+{
+    auto& events = USARTInterrupt::Get(&usart);
+    events.HandleTxComplete(NULL, NULL);
+    events.HandleRx(NULL, NULL);
+}
+
+size_t RS485Pipe::DETransmitter::TryAddBlock(Span block)
+{
+    auto& usart = owner.usart;
+
+    PLATFORM_CRITICAL_SECTION();
+    if (!owner.transmitting)
+    {
+        // take over the bus, the receiver would only see our own echo
+        owner.transmitting = true;
+        owner.waiting = false;
+        owner.txStart = MONO_CLOCKS;
+        usart.CR1 &= ~USART_CR1_RE;
+    }
+    // TC must be cleared before linking, otherwise the completion of the
+    // previous transmission would turn the bus around too early
+    usart.ICR = USART_ICR_TCCF;
+    usart.CR1 |= USART_CR1_TCIE;
+    return DMATransmitter::TryAddBlock(block);
+}
+
+void RS485Pipe::TxComplete(void* context)
+{
+    auto& p = *(RS485Pipe*)context;
+    // DE is released by hardware after the deassertion time, the receiver can be enabled right away
+    p.usart.CR1 |= USART_CR1_RE;
+    p.txEnd = MONO_CLOCKS;
+    p.txTime = p.txEnd - p.txStart;
+    p.transmitting = false;
+    p.waiting = true;
+}
+
+void RS485Pipe::RxEvent(void* context, uint32_t status)
+{
+    auto& p = *(RS485Pipe*)context;
+    if ((status & USART_ISR_IDLE) && p.waiting)
+    {
+        // the response has ended
+        p.responseTime = MONO_CLOCKS - p.txEnd;
+        p.waiting = false;
+        p.transactions++;
+    }
+}
+
+}
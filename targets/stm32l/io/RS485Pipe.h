@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2024 triaxis s.r.o.
+ * Licensed under the MIT license. See LICENSE.txt file in the repository root
+ * for full license information.
+ *
+ * stm32l/io/RS485Pipe.h
+ *
+ * Half-duplex RS-485 duplex pipe with the driver enable signal driven by the USART.
+ *
+ * DE is output on the RTS pin and its timing relative to the start and stop
+ * bits is guaranteed by hardware (DEAT/DEDT). The receiver is disabled while
+ * transmitting, so the local echo never reaches the receive pipe, and the bus
+ * is turned around directly from the transmission complete interrupt.
+ *
+ * Each transmission followed by a reception is treated as a transaction, the
+ * time spent transmitting and waiting for the end of the response is recorded.
+ * The pipe uses both the transmission complete and the receive event handlers
+ * of USARTInterrupt, so it cannot be combined with USARTFrameReceiver.
+ */
+
+#pragma once
+
+#include <io/io.h>
+
+namespace io
+{
+
+class RS485Pipe
+{
+public:
+    //! Creates the pipe, assertTime and deassertTime specify the DE lead and tail time in sample times (1/16 or 1/8 bit, max. 31)
+    template<unsigned n> RS485Pipe(_USART<n>* usart, GPIOPin de, unsigned assertTime = 16, unsigned deassertTime = 16, bool invertDe = false)
+        : usart(*usart), receiver(usart), transmitter(usart, new DETransmitter(*this, *usart->DmaTx(), &usart->TDR, DMADescriptor::PrioHigh))
+        { usart->ConfigureRts(de); Init(assertTime, deassertTime, invertDe); }
+    template<unsigned n> RS485Pipe(_USART<n>* usart, size_t rxBufferSize, GPIOPin de, unsigned assertTime = 16, unsigned deassertTime = 16, bool invertDe = false)
+        : usart(*usart), receiver(usart, rxBufferSize), transmitter(usart, new DETransmitter(*this, *usart->DmaTx(), &usart->TDR, DMADescriptor::PrioHigh))
+        { usart->ConfigureRts(de); Init(assertTime, deassertTime, invertDe); }
+
+    ~RS485Pipe();
+
+    operator DuplexPipe() { return { receiver, transmitter }; }
+
+    void Start()
+    {
+        receiver.Start();
+        transmitter.Start();
+    }
+
+    //! Gets the number of completed transactions (transmission followed by a response)
+    uint32_t Transactions() const { return transactions; }
+    //! Gets the duration of the last transmission, from the first byte queued to the bus turnaround
+    mono_t TxTime() const { return txTime; }
+    //! Gets the time from the last bus turnaround to the end of the response (idle line)
+    mono_t ResponseTime() const { return responseTime; }
+
+private:
+    class DETransmitter final : public DMATransmitter
+    {
+    public:
+        DETransmitter(RS485Pipe& owner, DMAChannel& dma, volatile void* destination, DMADescriptor::Flags flags)
+            : DMATransmitter(dma, destination, flags), owner(owner) {}
+
+    protected:
+        virtual size_t TryAddBlock(Span block);
+
+    private:
+        RS485Pipe& owner;
+    };
+
+    void Init(unsigned assertTime, unsigned deassertTime, bool invertDe);
+    static void TxComplete(void* context);
+    static void RxEvent(void* context, uint32_t status);
+
+    USART& usart;
+    USARTReceiver receiver;
+    USARTTransmitter transmitter;
+    bool transmitting;      //< the receiver is disabled until TC
+    bool waiting;           //< waiting for the end of a response
+    mono_t txStart, txEnd, txTime, responseTime;
+    uint32_t transactions;
+};
+
+}
@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2024 triaxis s.r.o.
+ * Licensed under the MIT license. See LICENSE.txt file in the repository root
+ * for full license information.
+ *
+ * stm32l/io/USARTFrameReceiver.cpp
+ */
+
+#include "USARTFrameReceiver.h"
+
+namespace io
+{
+
+USARTFrameReceiver::USARTFrameReceiver(USART& usart, DMAChannel& dma, unsigned timeoutBits, DMADescriptor::Flags flags)
+    : usart(usart), events(USARTInterrupt::Get(&usart)), dma(dma), irq(dma.IRQ()),
+    start{}, frame{}, done{}, end{}, dmaEnd{}, next{}, nextEnd{}, pending(0), dropped(0), wake(0)
+{
+    ASSERT(usart.CR2 & USART_CR2_RTOEN);
+    MODMASK(usart.RTOR, USART_RTOR_RTO, timeoutBits << USART_RTOR_RTO_Pos);
+
+    dma.CPAR = uint32_t(&usart.RDR);
+    dma.CCR = flags | DMADescriptor::P2M | DMADescriptor::IncrementMemory | DMADescriptor::UnitByte | DMADescriptor::InterruptComplete;
+    // both handlers run at the same priority, so they never preempt each other
+    irq.SetHandler(this, &USARTFrameReceiver::DmaHandler);
+    irq.Priority(CORTEX_MAXIMUM_PRIO);
+    irq.Enable();
+
+    events.HandleRx(&USARTFrameReceiver::EventHandler, this);
+    events.RxEvents(false, false, true);
+}
+
+USARTFrameReceiver::~USARTFrameReceiver()
+{
+    events.RxEvents(false);
+    events.HandleRx(NULL, NULL);
+    irq.Disable();
+    dma.Disable();
+}
+
+size_t USARTFrameReceiver::TryAddBuffer(size_t offset, Buffer buf)
+{
+    if (buf.Length() <= HeaderSize)
+    {
+        // cannot hold even a header and a single character
+        return 0;
+    }
+
+    size_t res = buf.Length();
+
+    PLATFORM_CRITICAL_SECTION();
+    if (!frame)
+    {
+        // nothing running, start immediately, continuing the previous buffer if possible
+        if (buf.begin() != end)
+        {
+            start = done = buf.begin();
+        }
+        end = buf.end();
+        Start(done);
+    }
+    else if (!next)
+    {
+        // set next buffer
+        next = buf.begin();
+        nextEnd = buf.end();
+    }
+    else if (nextEnd == buf.begin())
+    {
+        // extend next buffer
+        nextEnd = buf.end();
+    }
+    else
+    {
+        res = 0;
+    }
+
+    return res;
+}
+
+const char* USARTFrameReceiver::GetWritePointer(Buffer buf)
+{
+    char *start, *end, *done, *next, *nextEnd;
+    {
+        PLATFORM_CRITICAL_SECTION();
+        start = this->start, end = this->end, done = this->done, next = this->next, nextEnd = this->nextEnd;
+    }
+
+    auto p = buf.Pointer();
+    if (p >= start && p <= end)
+    {
+        // only complete frames are made available
+        return done >= p && done <= end ? done : p;
+    }
+
+    if (p >= next && p <= nextEnd)
+    {
+        // not started yet
+        return p;
+    }
+
+    // the buffer has been filled completely, including padding
+    return buf.end();
+}
+
+async_once(USARTFrameReceiver::Wait, const char* current, Timeout timeout)
+{
+    // capture the counter before checking for data so no frame gets lost
+    uint32_t wake = this->wake;
+    if (done != current)
+    {
+        async_once_return(true);
+    }
+    return async_forward(WaitMaskNot, this->wake, ~0u, wake, timeout);
+}
+
+async_once(USARTFrameReceiver::Close)
+{
+    PLATFORM_CRITICAL_SECTION();
+    dma.Disable();
+    dma.ClearInterrupt();
+    start = frame = done = end = next = nextEnd = NULL;
+    pending = 0;
+    async_once_return(0);
+}
+
+void USARTFrameReceiver::Start(char* frame)
+{
+    ASSERT(end - frame > ptrdiff_t(HeaderSize));
+    this->frame = frame;
+    auto data = frame + HeaderSize;
+    // longer frames are split as if the buffer overflowed, the length must fit the header as well
+    dmaEnd = data + std::min(size_t(end - data), size_t(DMA_CNDTR_NDT));
+    dma.CMAR = uint32_t(data);
+    dma.CNDTR = dmaEnd - data;
+    __DMB();    // make sure the other registers are written before enabling DMA
+    dma.ClearAndEnable();
+}
+
+void USARTFrameReceiver::Finish(uint32_t status, bool overflow)
+{
+    usart.ICR = USART_ICR_FECF | USART_ICR_NCF | USART_ICR_PECF | USART_ICR_ORECF;
+
+    if (!frame)
+    {
+        // there is no buffer to receive into, the frame is lost
+        if (!overflow)
+        {
+            // the rest of a continued frame is lost as well, the next frame starts fresh
+            pending = (pending & ~FrameContinued) | FrameDropped;
+            dropped++;
+        }
+        return;
+    }
+
+    dma.Disable();
+    auto data = frame + HeaderSize;
+    size_t len = (dmaEnd - data) - dma.CNDTR;
+    ASSERT(len <= UINT16_MAX);
+
+    if (!len)
+    {
+        // nothing received since the last frame (e.g. an overflowed frame ended exactly at the end of the buffer)
+        pending &= ~FrameContinued;
+        dma.Enable();
+        return;
+    }
+
+    uint8_t st = pending;
+    pending = 0;
+    if (overflow)
+    {
+        st |= FrameOverflow;
+        pending = FrameContinued;
+    }
+    if (status & (USART_ISR_FE | USART_ISR_NE | USART_ISR_PE))
+    {
+        st |= FrameError;
+    }
+    if (status & USART_ISR_ORE)
+    {
+        st |= FrameOverrun;
+    }
+
+    if (next == end)
+    {
+        // the next buffer directly follows the current one, merge them
+        end = nextEnd;
+        next = nextEnd = NULL;
+    }
+
+    auto e = data + len;
+    // a few bytes not large enough for another frame are appended as padding
+    size_t left = end - e;
+    uint8_t padding = left <= HeaderSize ? left : 0;
+    FrameHeader h = { uint16_t(len), st, padding };
+    memcpy(frame, &h, sizeof(h));
+    e += padding;
+
+    if (e != end)
+    {
+        done = e;
+        Start(e);
+    }
+    else if (next)
+    {
+        start = done = next;
+        end = nextEnd;
+        next = nextEnd = NULL;
+        Start(start);
+    }
+    else
+    {
+        done = e;
+        frame = NULL;
+    }
+
+    wake++;
+}
+
+void USARTFrameReceiver::DmaHandler()
+{
+    dma.ClearInterrupt();
+    // the buffer is full, but the frame has not ended yet
+    Finish(usart.ISR, true);
+}
+
+void USARTFrameReceiver::EventHandler(void* context, uint32_t status)
+{
+    if (status & USART_ISR_RTOF)
+    {
+        ((USARTFrameReceiver*)context)->Finish(status, false);
+    }
+}
+
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2024 triaxis s.r.o.
+ * Licensed under the MIT license. See LICENSE.txt file in the repository root
+ * for full license information.
+ *
+ * stm32l/io/USARTFrameReceiver.h
+ *
+ * A frame-oriented USART receiver strategy using DMA and the hardware receive timeout.
+ *
+ * Frames are delimited by the line being idle for the configured number of bit
+ * times (e.g. 3.5 characters for Modbus RTU). Every frame is written into the
+ * pipe as a FrameHeader followed by the frame data and optional padding, and
+ * becomes visible to the reader only once it is complete, so there is no need
+ * to inspect the incoming bytes one by one.
+ *
+ * The USART must be configured with RxTimeout and RxDma enabled.
+ */
+
+#pragma once
+
+#include <io/Receiver.h>
+
+#include <hw/DMA.h>
+
+#include "USARTInterrupt.h"
+
+namespace io
+{
+
+class USARTFrameReceiver final : public Receiver
+{
+public:
+    enum FrameStatus
+    {
+        //! The frame did not fit into the buffer, the rest of the data follows in the next frame
+        FrameOverflow = 1,
+        //! The frame is the continuation of a previous frame marked with FrameOverflow
+        FrameContinued = 2,
+        //! Framing, noise or parity error was detected during the frame
+        FrameError = 4,
+        //! Some characters were lost due to an USART overrun
+        FrameOverrun = 8,
+        //! Some frames before this one were lost because no buffer was available
+        FrameDropped = 16,
+    };
+
+    //! Header preceding each frame in the pipe
+    struct FrameHeader
+    {
+        uint16_t length;    //< length of the frame data following the header
+        uint8_t status;     //< combination of FrameStatus flags
+        uint8_t padding;    //< number of unused bytes following the frame data
+    };
+
+    static constexpr size_t HeaderSize = sizeof(FrameHeader);
+
+    //! Reads a frame header from the pipe data, which need not be aligned
+    static FrameHeader ReadHeader(const char* p) { FrameHeader h; memcpy(&h, p, sizeof(h)); return h; }
+
+    USARTFrameReceiver(USART& usart, DMAChannel& dma, unsigned timeoutBits, DMADescriptor::Flags flags = {});
+    ~USARTFrameReceiver();
+
+    //! Gets the number of frames that were lost because no buffer was available
+    uint32_t DroppedFrames() const { return dropped; }
+
+protected:
+    virtual size_t TryAddBuffer(size_t offset, Buffer buffer);
+    virtual const char* GetWritePointer(Buffer buffer);
+    virtual async_once(Wait, const char* current, Timeout timeout = Timeout::Infinite);
+    virtual async_once(Close);
+
+private:
+    USART& usart;
+    USARTInterrupt& events;
+    DMAChannel& dma;
+    IRQ irq;
+    char* start;            //< start of the buffer being filled
+    char* frame;            //< header of the frame being received, NULL if stopped
+    char* done;             //< end of the last completed frame
+    char* end;              //< end of the buffer being filled
+    char* dmaEnd;           //< end of the current DMA transfer, limited by the maximum transfer size
+    char* next;             //< start of the next buffer
+    char* nextEnd;          //< end of the next buffer
+    uint8_t pending;        //< status flags to be reported with the next frame
+    uint32_t dropped;
+    volatile uint32_t wake; //< incremented whenever a frame is completed
+
+    void Start(char* frame);
+    void Finish(uint32_t status, bool overflow);
+    void DmaHandler();
+    static void EventHandler(void* context, uint32_t status);
+};
+
+}
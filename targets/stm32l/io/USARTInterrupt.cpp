@@ -20,6 +20,11 @@ namespace io
 {
 
 USARTInterrupt& USARTInterrupt::Get(USART* usart)
+{
+    return Get(usart, (void*)NULL);
+}
+
+USARTInterrupt& USARTInterrupt::Get(USART* usart, void* storage)
 {
     auto irq = usart->IRQ();
     if (auto arg = irq.HandlerArgument())
@@ -27,7 +32,7 @@ USARTInterrupt& USARTInterrupt::Get(USART* usart)
         return *(USARTInterrupt*)arg;
     }
 
-    auto res = new(malloc_once(sizeof(USARTInterrupt))) USARTInterrupt(*usart, irq);
+    auto res = new(storage ? storage : malloc_once(sizeof(USARTInterrupt))) USARTInterrupt(*usart, irq);
     irq.SetHandler(res, &USARTInterrupt::Handler);
     irq.Priority(CORTEX_MAXIMUM_PRIO);
     return *res;
@@ -36,54 +41,134 @@ USARTInterrupt& USARTInterrupt::Get(USART* usart)
 OPTIMIZE void USARTInterrupt::Handler()
 {
     auto status = usart.ISR;
-    if (status & USART_ISR_RXNE)
+    if ((status & USART_ISR_WUF) && (usart.CR3 & USART_CR3_WUFIE))
+    {
+        // woken up from Stop mode, anything already received had to wait for the clocks
+        usart.ICR = USART_ICR_WUCF;
+        stopWakeups++;
+        stopEarlyChars += !!(status & USART_ISR_RXNE) + !!(status & USART_ISR_ORE);
+        if (!stopHold)
+        {
+            // keep the clocks running until the end of the burst, remembering whether
+            // deep sleep was allowed at all, so that we don't override anyone else's setting
+            stopHold = true;
+            stopSleepDeep = SCB->SCR & SCB_SCR_SLEEPDEEP_Msk;
+            PLATFORM_DEEP_SLEEP_DISABLE();
+            usart.ICR = USART_ICR_IDLECF;
+            usart.CR1 |= USART_CR1_IDLEIE;
+        }
+    }
+
+    if (status & (USART_ISR_IDLE | USART_ISR_CMF | USART_ISR_RTOF))
+    {
+        if (status & USART_ISR_IDLE)
+        {
+            if (stopHold)
+            {
+                StopRelease();
+            }
+            if (muteOnIdle)
+            {
+                // the end of our frame, ignore everything until we are addressed again
+                usart.ICR = USART_ICR_IDLECF;
+                usart.Mute();
+            }
+        }
+
+        // the flags are set regardless of the interrupt enable bits, report only the selected ones
+        auto events = status & rxEvents;
+        if (events)
+        {
+            usart.ICR = events;
+            idleEvents += !!(events & USART_ISR_IDLE);
+            matchEvents += !!(events & USART_ISR_CMF);
+            timeoutEvents += !!(events & USART_ISR_RTOF);
+            if (rxHandler)
+            {
+                rxHandler(rxContext, status);
+            }
+            if (rxNotify)
+            {
+                (*rxNotify)++;
+            }
+        }
+    }
+
+    if (status & USART_ISR_ORE)
+    {
+        // the overrun interrupt is enabled together with RXNE and must be cleared
+        MYTRACE('#');
+        usart.ICR = USART_ICR_ORECF;
+        overruns++;
+    }
+
+    // drain as much data as possible in a single pass, on devices with FIFO
+    // the flags remain set until the FIFO is empty/full - unless the data
+    // is received using DMA and we are here just because of a receive event
+    while ((status & USART_ISR_RXNE) && (usart.CR1 & USART_CR1_RXNEIE))
     {
         MYTRACE('<');
-        return rx.Write(usart.RDR);
+        if (rx.IsEmpty())
+        {
+            MYTRACE('!');
+            (void)usart.RDR;
+            droppedBytes++;
+        }
+        else
+        {
+            rx.Write(usart.RDR);
+        }
+        status = usart.ISR;
     }
-    if (status & USART_ISR_TXE)
+
+    while (status & USART_ISR_TXE)
     {
-        if (tx.p == tx.e)
+        if (tx.IsEmpty())
         {
             usart.CR1 &= ~USART_CR1_TXEIE;
+            break;
         }
-        else
+        tx.ReadInto(&usart.TDR);
+        status = usart.ISR;
+    }
+
+    if ((status & USART_ISR_TC) && (usart.CR1 & USART_CR1_TCIE))
+    {
+        usart.CR1 &= ~USART_CR1_TCIE;
+        if (txHandler)
         {
-            return tx.ReadInto(&usart.TDR);
+            txHandler(txContext);
         }
     }
 }
 
 OPTIMIZE void USARTInterrupt::Buf::Write(char b)
 {
-    auto p = this->p, e = this->e;
-    if (p == e) { MYTRACE('!'); return; }
     *p++ = b;
-    if (p == e && p2)
-    {
-        this->p = p2;
-        this->e = e2;
-        p2 = e2 = NULL;
-    }
-    else
+    if (p == e)
     {
-        this->p = p;
+        Next();
     }
 }
 
 OPTIMIZE void USARTInterrupt::Buf::ReadInto(volatile uint32_t* reg)
 {
-    auto p = this->p, e = this->e;
     *reg = *p++;
-    if (p == e && p2)
+    if (p == e)
     {
-        this->p = p2;
-        this->e = e2;
-        p2 = e2 = NULL;
+        Next();
     }
-    else
+}
+
+OPTIMIZE void USARTInterrupt::Buf::Next()
+{
+    if (count)
     {
-        this->p = p;
+        auto& seg = queue[head];
+        p = seg.p;
+        e = seg.e;
+        head = (head + 1) % USART_INTERRUPT_QUEUE_DEPTH;
+        count--;
     }
 }
 
@@ -91,22 +176,22 @@ bool USARTInterrupt::AddBuffer(bool tx, char* p, char* e)
 {
     irq.Disable();
     auto& b = tx ? this->tx : this->rx;
-    if (b.p == b.e)
+    if (b.IsEmpty())
     {
-        // set first buffer
+        // set current buffer
         b.p = p;
         b.e = e;
     }
-    else if (!b.p2)
+    else if ((b.count ? b.Last().e : b.e) == p)
     {
-        // set second buffer
-        b.p2 = p;
-        b.e2 = e;
+        // extend the last buffer
+        (b.count ? b.Last().e : b.e) = e;
     }
-    else if (b.e2 == p)
+    else if (b.CanAdd())
     {
-        // extend second buffer
-        b.e2 = e;
+        // queue another buffer
+        b.count++;
+        b.Last() = { p, e };
     }
     else
     {
@@ -118,6 +203,95 @@ bool USARTInterrupt::AddBuffer(bool tx, char* p, char* e)
     return true;
 }
 
+void USARTInterrupt::HandleRx(RxEventHandler handler, void* context)
+{
+    irq.Disable();
+    rxHandler = handler;
+    rxContext = context;
+    irq.Enable();
+}
+
+void USARTInterrupt::HandleTxComplete(TxEventHandler handler, void* context)
+{
+    irq.Disable();
+    txHandler = handler;
+    txContext = context;
+    irq.Enable();
+}
+
+void USARTInterrupt::RxEvents(bool idle, bool charMatch, bool timeout)
+{
+    irq.Disable();
+    // clear stale flags so they don't cause an immediate wake
+    usart.ICR = USART_ICR_IDLECF | USART_ICR_CMCF | USART_ICR_RTOCF;
+    rxEvents = USART_ISR_IDLE * idle | USART_ISR_CMF * charMatch | USART_ISR_RTOF * timeout;
+    MODMASK(usart.CR1, USART_CR1_CMIE | USART_CR1_RTOIE, USART_CR1_CMIE * charMatch | USART_CR1_RTOIE * timeout);
+    UpdateIdleInterrupt();
+    irq.Enable();
+}
+
+void USARTInterrupt::MuteOnIdle(bool enable)
+{
+    irq.Disable();
+    muteOnIdle = enable;
+    usart.ICR = USART_ICR_IDLECF;
+    UpdateIdleInterrupt();
+    irq.Enable();
+}
+
+void USARTInterrupt::UpdateIdleInterrupt()
+{
+    MODMASK(usart.CR1, USART_CR1_IDLEIE, USART_CR1_IDLEIE * ((rxEvents & USART_ISR_IDLE) || muteOnIdle || stopHold));
+}
+
+void USARTInterrupt::EnableStopRx(unsigned baudRate, USART::KernelClockSource clock, USART::WakeInterruptMode wake)
+{
+    if (clock == USART::KernelClockLSE)
+    {
+        ASSERT(RCC->BDCR & RCC_BDCR_LSERDY);
+    }
+    else
+    {
+        ASSERT(clock == USART::KernelClockHSI16);
+        // HSI16 is needed for reception in Run mode as well, in Stop mode
+        // the USART requests it by itself when it detects the wake-up event
+        RCC->CR |= RCC_CR_HSION;
+        while (!(RCC->CR & RCC_CR_HSIRDY));
+    }
+
+    irq.Disable();
+    auto cr1 = usart.CR1;
+    usart.CR1 = cr1 & ~USART_CR1_UE;
+    usart.KernelClock(clock);
+    usart.BaudRate(baudRate);
+    MODMASK(usart.CR3, USART_CR3_WUFIE | USART_CR3_WUS, wake);
+    usart.ICR = USART_ICR_WUCF;
+    usart.CR1 = usart.CR1 | USART_CR1_UESM | (cr1 & USART_CR1_UE);
+    irq.Enable();
+}
+
+void USARTInterrupt::DisableStopRx()
+{
+    irq.Disable();
+    usart.CR1 &= ~USART_CR1_UESM;
+    usart.CR3 &= ~USART_CR3_WUFIE;
+    if (stopHold)
+    {
+        StopRelease();
+    }
+    irq.Enable();
+}
+
+void USARTInterrupt::StopRelease()
+{
+    stopHold = false;
+    if (stopSleepDeep)
+    {
+        PLATFORM_DEEP_SLEEP_ENABLE();
+    }
+    UpdateIdleInterrupt();
+}
+
 void USARTInterrupt::Reset(Buf& b)
 {
     irq.Disable();
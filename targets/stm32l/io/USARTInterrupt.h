@@ -9,19 +9,37 @@
  *
  * Supports continuous transfers, but with per-transfer overhead caused
  * by interrupts being triggered. DMA should be used when possible.
+ *
+ * The handler also owns the USART receive events (idle line, character match,
+ * receive timeout), which can be used to wake DMA receivers at the end of a burst
+ * or on a delimiter, or handled directly by a receiver strategy.
+ *
+ * Reception in Stop mode is handled here as well: after the USART wakes up the
+ * MCU, deep sleep is held off until the line goes idle, so that the receive
+ * strategy (typically DMA, which is not clocked in Stop mode) can keep up with
+ * the rest of the burst without any changes.
  */
 
 #pragma once
 
 #include <hw/USART.h>
 
+#ifndef USART_INTERRUPT_QUEUE_DEPTH
+#define USART_INTERRUPT_QUEUE_DEPTH 4   // number of buffers that can be queued after the current one
+#endif
+
 namespace io
 {
 
+struct USARTInterruptStorage;
+
 class USARTInterrupt
 {
 public:
     static USARTInterrupt& Get(USART* usart);
+    //! Gets the handler for the USART, constructing it in the provided storage instead of the heap if it does not exist yet
+    /*! Must be called before any other code calls Get for the same USART, otherwise the storage is not used */
+    static USARTInterrupt& Get(USART* usart, USARTInterruptStorage& storage);
 
     bool AddRxBuffer(Buffer buf) { return AddBuffer(false, buf.begin(), buf.end()); }
     char* const& RxPointer() const { return rx.p; }
@@ -31,32 +49,111 @@ public:
     char* const& TxPointer() const { return tx.p; }
     void ResetTx() { Reset(tx); }
 
+    //! Handler of receive events, called from the interrupt with the ISR register value
+    typedef void (*RxEventHandler)(void* context, uint32_t status);
+
+    //! Sets the counter to be incremented on selected receive events, e.g. a DMA receiver wake counter
+    void NotifyRx(volatile uint32_t* counter) { rxNotify = counter; }
+    //! Sets the handler to be called on selected receive events
+    void HandleRx(RxEventHandler handler, void* context);
+    //! Selects the receive events, idle line after a burst, a character set using USART::MatchCharacter,
+    //! and/or receive timeout configured using USART::RxTimeout
+    void RxEvents(bool idle, bool charMatch = false, bool timeout = false);
+    //! Gets the number of idle line events
+    uint32_t IdleEvents() const { return idleEvents; }
+    //! Gets the number of character match events
+    uint32_t MatchEvents() const { return matchEvents; }
+    //! Gets the number of receive timeout events
+    uint32_t TimeoutEvents() const { return timeoutEvents; }
+    //! Gets the number of received bytes dropped because no receive buffer was available
+    uint32_t DroppedBytes() const { return droppedBytes; }
+    //! Gets the number of hardware overrun events (bytes lost because the interrupt was not handled in time)
+    uint32_t Overruns() const { return overruns; }
+
+    //! Handler of the transmission complete event, called from the interrupt
+    typedef void (*TxEventHandler)(void* context);
+
+    //! Sets the handler to be called once the transmission completes after enabling USART_CR1_TCIE,
+    //! the interrupt is disabled again before the handler is called
+    void HandleTxComplete(TxEventHandler handler, void* context);
+
+    //! Puts the receiver back into mute mode whenever the line goes idle, see USARTReceiver::ReceiveAddressed
+    void MuteOnIdle(bool enable);
+
+    //! Arms the USART for receiving in Stop mode, switching the kernel clock to HSI16 or LSE
+    //! (LPUART1 only, up to 9600 baud) and waking up on a start bit or address match
+    /*! The USART is briefly disabled while the clock and baud rate are changed, any receive strategy stays in place */
+    void EnableStopRx(unsigned baudRate, USART::KernelClockSource clock = USART::KernelClockHSI16, USART::WakeInterruptMode wake = USART::WakeInterruptStartBit);
+    //! Stops waking up from Stop mode, the kernel clock is left as it is
+    void DisableStopRx();
+    //! Gets the number of wake-ups from Stop mode caused by the USART
+    uint32_t StopWakeups() const { return stopWakeups; }
+    //! Gets a lower bound of the number of characters that arrived before the clocks recovered after a wake-up
+    /*! Counts a character found waiting in the receive register and an overrun at each wake-up,
+     *  the hardware does not tell how many characters were actually lost in the overrun */
+    uint32_t StopEarlyChars() const { return stopEarlyChars; }
+
 private:
     USARTInterrupt(USART& usart, IRQ irq)
-        : usart(usart), irq(irq), overrun(false), tx{}, rx{}
+        : usart(usart), irq(irq), tx{}, rx{}, droppedBytes(0), overruns(0), rxNotify(NULL), rxHandler(NULL), rxContext(NULL), rxEvents(0), txHandler(NULL), txContext(NULL),
+        idleEvents(0), matchEvents(0), timeoutEvents(0), muteOnIdle(false), stopHold(false), stopSleepDeep(false), stopWakeups(0), stopEarlyChars(0)
     {
     }
 
+    struct Seg {
+        char* p;
+        char* e;
+    };
+
     struct Buf {
         char* p;
         char* e;
-        char* p2;
-        char* e2;
+        uint8_t head;
+        uint8_t count;
+        Seg queue[USART_INTERRUPT_QUEUE_DEPTH];
 
-        bool CanAdd() const { return !p2; }
+        bool CanAdd() const { return count < USART_INTERRUPT_QUEUE_DEPTH; }
+        bool IsEmpty() const { return p == e; }
         operator char*() const { return p; }
+        Seg& Last() { return queue[(head + count - 1) % USART_INTERRUPT_QUEUE_DEPTH]; }
         void Write(char b);
         void ReadInto(volatile uint32_t* p);
+        void Next();
     };
 
+    static USARTInterrupt& Get(USART* usart, void* storage);
+
     void Handler();
     bool AddBuffer(bool tx, char* p, char* e);
     void Reset(Buf& b);
 
     USART& usart;
     IRQ irq;
-    bool overrun;
     Buf tx, rx;
+    uint32_t droppedBytes, overruns;
+    volatile uint32_t* rxNotify;
+    RxEventHandler rxHandler;
+    void* rxContext;
+    uint32_t rxEvents;      //< ISR flags of the selected receive events
+    TxEventHandler txHandler;
+    void* txContext;
+    uint32_t idleEvents, matchEvents, timeoutEvents;
+    bool muteOnIdle;
+    bool stopHold;          //< deep sleep is disabled until the line goes idle
+    bool stopSleepDeep;     //< deep sleep was enabled before the hold
+    uint32_t stopWakeups, stopEarlyChars;
+
+    void StopRelease();
+    //! Enables the idle line interrupt if it is needed by any of the features
+    void UpdateIdleInterrupt();
 };
 
+//! Static storage for an USARTInterrupt instance
+struct alignas(USARTInterrupt) USARTInterruptStorage
+{
+    char data[sizeof(USARTInterrupt)];
+};
+
+inline USARTInterrupt& USARTInterrupt::Get(USART* usart, USARTInterruptStorage& storage) { return Get(usart, (void*)storage.data); }
+
 }
@@ -20,7 +20,7 @@
 namespace io
 {
 
-class USARTInterruptReceiver : public Receiver
+class USARTInterruptReceiver final : public Receiver
 {
 public:
     USARTInterruptReceiver(USARTInterrupt& handler)
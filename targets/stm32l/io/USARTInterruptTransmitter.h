@@ -20,7 +20,7 @@
 namespace io
 {
 
-class USARTInterruptTransmitter : public Transmitter
+class USARTInterruptTransmitter final : public Transmitter
 {
 public:
     USARTInterruptTransmitter(USARTInterrupt& handler)
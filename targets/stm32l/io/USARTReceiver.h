@@ -19,16 +19,25 @@ class USARTReceiver
 {
 public:
     USARTReceiver(USART* usart, Receiver* receiver)
-        : usart(usart), receiver(receiver) {}
+        : usart(usart), receiver(receiver), wakeCounter(NULL), notifying(false) {}
 
     USARTReceiver(USART* usart)
-        : usart(usart), receiver(new USARTInterruptReceiver(USARTInterrupt::Get(usart))) {}
+        : usart(usart), receiver(new USARTInterruptReceiver(USARTInterrupt::Get(usart))), wakeCounter(NULL), notifying(false) {}
     template<unsigned n> USARTReceiver(_USART<n>* usart)
-        : usart(usart), receiver(new DMAReceiver(*usart->DmaRx(), &usart->RDR, DMADescriptor::PrioHigh)) {}
+        : usart(usart), receiver(new DMAReceiver(*usart->DmaRx(), &usart->RDR, DMADescriptor::PrioHigh)), wakeCounter(&WakeCounter<DMAReceiver>), notifying(false) {}
     template<unsigned n> USARTReceiver(_USART<n>* usart, size_t bufferSize)
-        : usart(usart), receiver(CreateDMAReceiverCircularWithBuffer(*usart->DmaRx(), &usart->RDR, bufferSize, DMADescriptor::PrioHigh)) {}
+        : usart(usart), receiver(CreateDMAReceiverCircularWithBuffer(*usart->DmaRx(), &usart->RDR, bufferSize, DMADescriptor::PrioHigh)), wakeCounter(&WakeCounter<DMAReceiverCircular>), notifying(false) {}
 
-    ~USARTReceiver() { delete receiver; }
+    ~USARTReceiver()
+    {
+        if (notifying)
+        {
+            auto& events = USARTInterrupt::Get(usart);
+            events.RxEvents(false);
+            events.NotifyRx(NULL);
+        }
+        delete receiver;
+    }
 
     operator PipeReader() { return pipe; }
 
@@ -37,10 +46,108 @@ public:
         receiver->StartReceiveToPipe(pipe, blockHint);
     }
 
+    //! Selects the events waking the reader of a DMA receiver in addition to DMA half/full transfer
+    /*! DMA receivers do not use the USART interrupt unless requested here, must be called before Start.
+     *  Character match requires the character to be configured using USART::MatchCharacter */
+    void WakeOn(bool idle, bool charMatch = false)
+    {
+        auto& events = USARTInterrupt::Get(usart);
+        if (wakeCounter)
+        {
+            events.NotifyRx(&wakeCounter(receiver));
+            notifying = true;
+        }
+        events.RxEvents(idle, charMatch);
+    }
+
+    //! Receives only frames addressed to this node on a multi-drop bus, frames for other nodes are discarded in hardware
+    /*! Each frame must start with an address character with the MSB set (the 9th bit when using 9 data bits),
+     *  which is delivered to the pipe as the first character of the frame. The receiver is muted until
+     *  a character matching @p address arrives and muted again by a non-matching address character
+     *  or at the end of the frame (idle line). @p address7 selects 7-bit instead of 4-bit address matching */
+    void ReceiveAddressed(uint8_t address, bool address7 = true)
+    {
+        // the wake-up method and address can be changed only while the USART is disabled
+        auto ue = usart->CR1 & USART_CR1_UE;
+        usart->Configure(USART::Enable(false));
+        usart->Configure(address7 ? USART::Address7(address) : USART::Address4(address));
+        usart->Configure(USART::Mute(USART::MuteAddress));
+        usart->CR1 |= ue;
+        usart->Mute();
+        USARTInterrupt::Get(usart).MuteOnIdle(true);
+    }
+
 private:
+    template<typename T> static volatile uint32_t& WakeCounter(Receiver* receiver) { return static_cast<T*>(receiver)->UseWakeCounter(); }
+
     Pipe pipe;
     USART* usart;
     Receiver* receiver;
+    //! switches the DMA receiver to sleeping on a wake counter, NULL for other strategies
+    volatile uint32_t& (*wakeCounter)(Receiver* receiver);
+    bool notifying;     //< the USART interrupt handler points to our wake counter
+};
+
+//! USARTReceiver variant with the receive strategy embedded, suitable for static storage
+/*! The strategy is constructed in place from the arguments following the USART, and calls
+ *  on the concrete (final) strategy type are resolved at compile time, e.g.
+ *  @code
+ *  static char rxBuf[256];
+ *  io::USARTReceiverT<io::DMAReceiverCircular> rx(USART1, *USART1->DmaRx(), &USART1->RDR, Buffer(rxBuf, sizeof(rxBuf)), DMADescriptor::PrioHigh);
+ *  @endcode
+ */
+template<typename TReceiver> class USARTReceiverT
+{
+public:
+    template<typename... Args> USARTReceiverT(USART* usart, Args&&... args)
+        : usart(usart), receiver(std::forward<Args>(args)...), notifying(false) {}
+
+    ~USARTReceiverT()
+    {
+        if (notifying)
+        {
+            // the handler outlives us, it must not increment the counter of a destroyed receiver
+            auto& events = USARTInterrupt::Get(usart);
+            events.RxEvents(false);
+            events.NotifyRx(NULL);
+        }
+    }
+
+    operator PipeReader() { return pipe; }
+
+    void Start(size_t blockHint = 1)
+    {
+        receiver.StartReceiveToPipe(pipe, blockHint);
+    }
+
+    //! Gets the embedded receive strategy
+    TReceiver& Strategy() { return receiver; }
+
+    //! Makes a DMA receiver strategy sleep until one of the selected events occurs instead of polling the DMA
+    void WakeOn(bool idle, bool charMatch = false)
+    {
+        WakeOn(USARTInterrupt::Get(usart), idle, charMatch);
+    }
+
+    //! Same as WakeOn(bool, bool), constructing the USART interrupt handler in the provided storage unless it already exists
+    /*! The handler is never destroyed, so the storage must be static */
+    void WakeOn(USARTInterruptStorage& storage, bool idle, bool charMatch = false)
+    {
+        WakeOn(USARTInterrupt::Get(usart, storage), idle, charMatch);
+    }
+
+private:
+    Pipe pipe;
+    USART* usart;
+    TReceiver receiver;
+    bool notifying;     //< the USART interrupt handler points to our wake counter
+
+    void WakeOn(USARTInterrupt& events, bool idle, bool charMatch)
+    {
+        events.NotifyRx(&receiver.UseWakeCounter());
+        events.RxEvents(idle, charMatch);
+        notifying = true;
+    }
 };
 
-}
\ No newline at end of file
+}
@@ -25,6 +25,8 @@ public:
         : usart(usart), transmitter(new USARTInterruptTransmitter(USARTInterrupt::Get(usart))) {}
     template<unsigned n> USARTTransmitter(_USART<n>* usart)
         : usart(usart), transmitter(new DMATransmitter(*usart->DmaTx(), &usart->TDR, DMADescriptor::PrioHigh)) {}
+    template<unsigned n> USARTTransmitter(_USART<n>* usart, size_t bufferSize)
+        : usart(usart), transmitter(CreateDMATransmitterCircularWithBuffer(*usart->DmaTx(), &usart->TDR, bufferSize, DMADescriptor::PrioHigh)) {}
 
     ~USARTTransmitter() { delete transmitter; }
 
@@ -41,4 +43,28 @@ private:
     Transmitter* transmitter;
 };
 
+//! USARTTransmitter variant with the transmit strategy embedded, suitable for static storage
+/*! The strategy is constructed in place from the arguments following the USART, see USARTReceiverT */
+template<typename TTransmitter> class USARTTransmitterT
+{
+public:
+    template<typename... Args> USARTTransmitterT(USART* usart, Args&&... args)
+        : usart(usart), transmitter(std::forward<Args>(args)...) {}
+
+    operator PipeWriter() { return pipe; }
+
+    void Start()
+    {
+        transmitter.StartTransmitFromPipe(pipe);
+    }
+
+    //! Gets the embedded transmit strategy
+    TTransmitter& Strategy() { return transmitter; }
+
+private:
+    Pipe pipe;
+    USART* usart;
+    TTransmitter transmitter;
+};
+
 }
@@ -13,13 +13,19 @@
 // include all receive/transmit strategies
 #include <io/DMAReceiver.h>
 #include <io/DMAReceiverCircular.h>
+#include <io/DMAReceiverPingPong.h>
 #include <io/DMATransmitter.h>
+#include <io/DMATransmitterCircular.h>
+
+#include <io/DMABridge.h>
 
 #include <io/USARTInterrupt.h>
 #include <io/USARTInterruptReceiver.h>
 #include <io/USARTInterruptTransmitter.h>
+#include <io/USARTFrameReceiver.h>
 
 #include <io/USARTReceiver.h>
 #include <io/USARTTransmitter.h>
 
 #include <io/USARTDuplexPipe.h>
+#include <io/RS485Pipe.h>